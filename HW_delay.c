@@ -15,25 +15,28 @@
 //***********************************************************************************
 // private variables
 //***********************************************************************************
+static uint32_t timer_evt; //scheduled event posted when the one shot of timer_event() expires
+static volatile bool timer_running;
 
 
 //***********************************************************************************
 // Private functions Prototypes
 //***********************************************************************************
+static void timer_oneshot_start(uint32_t ms_delay);
 
 
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
 
-
-//***********************************************************************************
-// Global functions
-//***********************************************************************************
-
-void timer_delay(uint32_t ms_delay){
+/***************************************************************************//**
+ * @brief
+ *  Loads TIMER0 as a one shot down counter expiring after ms_delay.
+ ******************************************************************************/
+static void timer_oneshot_start(uint32_t ms_delay){
 	uint32_t timer_clk_freq = CMU_ClockFreqGet(cmuClock_HFPER);
 	uint32_t delay_count = ms_delay *(timer_clk_freq/1000) / 1024;
+	EFM_ASSERT(delay_count <= _TIMER_CNT_MASK);
 	CMU_ClockEnable(cmuClock_TIMER0, true);
 	TIMER_Init_TypeDef delay_counter_init = TIMER_INIT_DEFAULT;
 		delay_counter_init.oneShot = true;
@@ -43,9 +46,71 @@ void timer_delay(uint32_t ms_delay){
 		delay_counter_init.debugRun = false;
 	TIMER_Init(TIMER0, &delay_counter_init);
 	TIMER0->CNT = delay_count;
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+void timer_delay(uint32_t ms_delay){
+	EFM_ASSERT(!timer_running); //TIMER0 is shared with timer_event()
+	timer_oneshot_start(ms_delay);
 	TIMER_Enable(TIMER0, true);
 	while (TIMER0->CNT != 00);
 	TIMER_Enable(TIMER0, false);
 	CMU_ClockEnable(cmuClock_TIMER0, false);
 }
 
+/***************************************************************************//**
+ * @brief
+ *  Posts evt once ms_delay has passed, without waiting for it.
+ *
+ * @details
+ *  Same one shot as timer_delay(), ended by the TIMER0 underflow interrupt instead of a busy
+ *  loop, so the CPU sleeps in the mean time. EM2 is blocked while the timer runs since TIMER0
+ *  stops with the high frequency clocks. Only one delay can be pending.
+ *
+ * @param[in] ms_delay
+ *  Delay in milliseconds
+ *
+ * @param[in] evt
+ *  Scheduled event posted when the delay has expired
+ ******************************************************************************/
+void timer_event(uint32_t ms_delay, uint32_t evt){
+	EFM_ASSERT(!timer_running);
+	timer_evt = evt;
+	timer_running = true;
+	timer_oneshot_start(ms_delay);
+	TIMER_IntClear(TIMER0, TIMER_IFC_UF);
+	TIMER_IntEnable(TIMER0, TIMER_IEN_UF);
+	NVIC_EnableIRQ(TIMER0_IRQn);
+	sleep_block_mode(TIMER_EVENT_EM);
+	TIMER_Enable(TIMER0, true);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns true while a timer_event() delay is pending.
+ ******************************************************************************/
+bool timer_event_busy(void){
+	return timer_running;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Ends a timer_event() delay: stops TIMER0, releases EM2 and posts the event.
+ ******************************************************************************/
+void TIMER0_IRQHandler(void){
+	uint32_t int_flag = TIMER0->IF & TIMER0->IEN;
+	TIMER0->IFC = int_flag;
+	if (int_flag & TIMER_IF_UF) {
+		TIMER_Enable(TIMER0, false);
+		TIMER_IntDisable(TIMER0, TIMER_IEN_UF);
+		CMU_ClockEnable(cmuClock_TIMER0, false);
+		sleep_unblock_mode(TIMER_EVENT_EM);
+		timer_running = false;
+		add_scheduled_event(timer_evt);
+	}
+}
+
@@ -10,7 +10,14 @@
 
 #include "em_timer.h"
 #include "em_cmu.h"
+#include "scheduler.h"
+#include "sleep_routines.h"
+
+#define TIMER_EVENT_EM  EM2   //TIMER0 runs from HFPERCLK, which stops in EM2
 
 void timer_delay(uint32_t ms_delay);
+void timer_event(uint32_t ms_delay, uint32_t evt);
+bool timer_event_busy(void);
+void TIMER0_IRQHandler(void);
 
 #endif /* SRC_HW_DELAY_H_ */
@@ -12,10 +12,21 @@
 // Private variables
 //***********************************************************************************
 bool	rgb_enabled_status;
+static bool rgb_pwm_opened = false; //rgb_pwm_open() has been called, the color lines go through rgb_level_set()
+static bool rgb_pwm_running = false; //TIMER1 drives the color lines, EM2 is blocked
+static uint32_t rgb_level[RGB_COLORS]; //brightness of each color, the end level while it fades
+static uint32_t rgb_fade_levels[RGB_COLORS][RGB_FADE_STEPS];
+static LDMA_Descriptor_t rgb_fade_desc[RGB_COLORS][RGB_FADE_STEPS];
+static const uint32_t rgb_fade_ch[RGB_COLORS] = { LDMA_CH_RGB_RED, LDMA_CH_RGB_GREEN, LDMA_CH_RGB_BLUE };
+static const uint32_t rgb_color_bit[RGB_COLORS] = { COLOR_RED, COLOR_GREEN, COLOR_BLUE };
+static const GPIO_Port_TypeDef rgb_color_port[RGB_COLORS] = { RGB_RED_PORT, RGB_GREEN_PORT, RGB_BLUE_PORT };
+static const uint32_t rgb_color_pin[RGB_COLORS] = { RGB_RED_PIN, RGB_GREEN_PIN, RGB_BLUE_PIN };
 
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
+static void rgb_pwm_run(bool run);
+static void rgb_pwm_update(void);
 
 
 //***********************************************************************************
@@ -33,6 +44,11 @@ void rgb_init(void) {
 
 void leds_enabled(uint32_t leds, uint32_t color, bool enable){
 
+    if (rgb_pwm_opened) {
+      rgb_level_set(color, enable ? RGB_LEVEL_ON : 0); //the color lines belong to TIMER1 now
+      color = NO_COLOR;
+    }
+
     if ((color & COLOR_RED) && enable) {
       GPIO_PinOutSet(RGB_RED_PORT,RGB_RED_PIN);
     } else if ((color & COLOR_RED) && !enable) GPIO_PinOutClear(RGB_RED_PORT,RGB_RED_PIN);
@@ -63,3 +79,177 @@ void leds_enabled(uint32_t leds, uint32_t color, bool enable){
 
 }
 
+/***************************************************************************//**
+ * @brief
+ *  Hands the red, green and blue lines to the compare outputs of TIMER1 for 8 bit brightness.
+ *
+ * @details
+ *  CC0, CC1 and CC2 run in PWM mode with TOP at RGB_PWM_TOP, so the compare value of a color is its
+ *  brightness. TIMER1 only runs while a color sits between off and fully on, or fades. Off and
+ *  fully on are driven by the GPIO like before, so an LED that is simply on does not keep the MCU
+ *  out of EM2. Call after gpio_open() and rgb_init(); leds_enabled() goes through rgb_level_set()
+ *  from then on.
+ ******************************************************************************/
+void rgb_pwm_open(void) {
+  TIMER_Init_TypeDef timer_init = TIMER_INIT_DEFAULT;
+  TIMER_InitCC_TypeDef cc_init = TIMER_INITCC_DEFAULT;
+
+  CMU_ClockEnable(RGB_PWM_CLOCK, true);
+  timer_init.enable = false;
+  timer_init.debugRun = false;
+  timer_init.prescale = RGB_PWM_PRESCALE;
+  timer_init.dmaClrAct = true; //the fades write CCVB on UFOF, which only a TOPB write clears otherwise: one write per period
+  TIMER_Init(RGB_PWM_TIMER, &timer_init);
+  cc_init.mode = timerCCModePWM;
+  for (uint32_t i = 0; i < RGB_COLORS; i++) {
+      TIMER_InitCC(RGB_PWM_TIMER, i, &cc_init);
+      rgb_level[i] = GPIO_PinOutGet(rgb_color_port[i], rgb_color_pin[i]) ? RGB_LEVEL_ON : 0;
+  }
+  TIMER_TopSet(RGB_PWM_TIMER, RGB_PWM_TOP);
+  RGB_PWM_TIMER->ROUTELOC0 = RED_RGB_LOC | GREEN_RGB_LOC | BLUE_RGB_LOC;
+  CMU_ClockEnable(RGB_PWM_CLOCK, false);
+  ldma_open();
+  rgb_pwm_opened = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Sets the brightness of one or more colors, cancelling a fade in progress.
+ *
+ * @details
+ *  While TIMER1 runs this is one write of the compare buffer, taken over at the next overflow so
+ *  the period in progress is not cut short. Otherwise off and fully on are one GPIO write, and any
+ *  other level starts TIMER1.
+ *
+ * @param[in] color
+ *  COLOR_RED, COLOR_GREEN and/or COLOR_BLUE
+ *
+ * @param[in] level
+ *  Brightness, 0 to RGB_PWM_TOP
+ ******************************************************************************/
+void rgb_level_set(uint32_t color, uint32_t level) {
+  EFM_ASSERT(rgb_pwm_opened && level <= RGB_PWM_TOP);
+  for (uint32_t i = 0; i < RGB_COLORS; i++) {
+      if (!(color & rgb_color_bit[i])) continue;
+      ldma_stop(rgb_fade_ch[i]);
+      rgb_level[i] = level;
+      if (rgb_pwm_running) TIMER_CompareBufSet(RGB_PWM_TIMER, i, level);
+  }
+  rgb_pwm_update();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Fades one or more colors from their current brightness to level over ms, without the CPU.
+ *
+ * @details
+ *  The way is cut into RGB_FADE_STEPS levels. One LDMA descriptor per level writes it to the
+ *  compare buffer on every TIMER1 overflow for the length of its step, so a step is one register
+ *  write per PWM period and nothing wakes the CPU. Each color has an LDMA channel of its own.
+ *  rgb_service() stops TIMER1 once the fades are over and it is no longer needed.
+ *
+ * @param[in] color
+ *  COLOR_RED, COLOR_GREEN and/or COLOR_BLUE
+ *
+ * @param[in] level
+ *  Brightness at the end of the fade, 0 to RGB_PWM_TOP
+ *
+ * @param[in] ms
+ *  Length of the fade
+ *
+ * @return
+ *  false, and nothing changed, when ms is longer than RGB_FADE_STEPS * RGB_FADE_HOLD_MAX PWM periods
+ ******************************************************************************/
+bool rgb_fade_start(uint32_t color, uint32_t level, uint32_t ms) {
+  uint32_t pwm_hz = (CMU_ClockFreqGet(cmuClock_HFPER) >> RGB_PWM_PRESCALE) / (RGB_PWM_TOP + 1);
+  uint32_t hold = (uint32_t)((uint64_t)ms * pwm_hz / (1000 * RGB_FADE_STEPS));
+
+  EFM_ASSERT(rgb_pwm_opened && level <= RGB_PWM_TOP);
+  if (hold > RGB_FADE_HOLD_MAX) return false;
+  if (!hold) hold = 1;
+
+  for (uint32_t i = 0; i < RGB_COLORS; i++) {
+      if (!(color & rgb_color_bit[i])) continue;
+      ldma_stop(rgb_fade_ch[i]);
+      int32_t from = rgb_pwm_running ? (int32_t)RGB_PWM_TIMER->CC[i].CCV : (int32_t)rgb_level[i];
+      LDMA_Descriptor_t *desc = rgb_fade_desc[i];
+
+      for (uint32_t s = 0; s < RGB_FADE_STEPS; s++) {
+          rgb_fade_levels[i][s] = from + ((int32_t)level - from) * (int32_t)(s + 1) / RGB_FADE_STEPS;
+          desc[s] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_M2P_WORD(&rgb_fade_levels[i][s], &RGB_PWM_TIMER->CC[i].CCVB, hold, 1);
+          desc[s].xfer.srcInc = ldmaCtrlSrcIncNone; //the same level for the whole step
+          desc[s].xfer.doneIfs = 0;
+      }
+      desc[RGB_FADE_STEPS - 1].xfer.link = 0;
+      rgb_level[i] = level;
+      ldma_start(rgb_fade_ch[i], ldmaPeripheralSignal_TIMER1_UFOF, desc);
+  }
+  rgb_pwm_update();
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns the brightness of a color, the level it fades to while a fade is in progress.
+ ******************************************************************************/
+uint32_t rgb_level_get(uint32_t color) {
+  for (uint32_t i = 0; i < RGB_COLORS; i++) {
+      if (color & rgb_color_bit[i]) return rgb_level[i];
+  }
+  return 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Called once per LETIMER period, stops TIMER1 once the fades are over and it is no longer needed.
+ ******************************************************************************/
+void rgb_service(void) {
+  if (rgb_pwm_running) rgb_pwm_update();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Runs TIMER1 while a color is dimmed or fading, otherwise leaves the color lines to the GPIO.
+ ******************************************************************************/
+static void rgb_pwm_update(void) {
+  bool pwm = false;
+
+  for (uint32_t i = 0; i < RGB_COLORS; i++) {
+      if (ldma_busy(rgb_fade_ch[i]) || (rgb_level[i] && rgb_level[i] < RGB_PWM_TOP)) pwm = true;
+  }
+  if (pwm != rgb_pwm_running) rgb_pwm_run(pwm);
+  if (!pwm) {
+      for (uint32_t i = 0; i < RGB_COLORS; i++) {
+          if (rgb_level[i]) GPIO_PinOutSet(rgb_color_port[i], rgb_color_pin[i]);
+          else GPIO_PinOutClear(rgb_color_port[i], rgb_color_pin[i]);
+      }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Starts or stops TIMER1 and moves the color lines between the compare outputs and the GPIO.
+ *
+ * @details
+ *  A starting timer loads the level of every color, or the first step of its fade.
+ ******************************************************************************/
+static void rgb_pwm_run(bool run) {
+  if (run) {
+      CMU_ClockEnable(RGB_PWM_CLOCK, true);
+      for (uint32_t i = 0; i < RGB_COLORS; i++) {
+          TIMER_CompareSet(RGB_PWM_TIMER, i, ldma_busy(rgb_fade_ch[i]) ? rgb_fade_levels[i][0] : rgb_level[i]);
+          RGB_PWM_TIMER->CC[i].CCVB = RGB_PWM_TIMER->CC[i].CCV;
+      }
+      RGB_PWM_TIMER->CNT = 0;
+      RGB_PWM_TIMER->ROUTEPEN = TIMER_ROUTEPEN_CC0PEN | TIMER_ROUTEPEN_CC1PEN | TIMER_ROUTEPEN_CC2PEN;
+      sleep_block_mode(RGB_PWM_EM);
+      TIMER_Enable(RGB_PWM_TIMER, true);
+  }
+  else {
+      TIMER_Enable(RGB_PWM_TIMER, false);
+      RGB_PWM_TIMER->ROUTEPEN = 0;
+      CMU_ClockEnable(RGB_PWM_CLOCK, false);
+      sleep_unblock_mode(RGB_PWM_EM);
+  }
+  rgb_pwm_running = run;
+}
@@ -11,9 +11,13 @@
 #include "stdbool.h"
 #include "stdint.h"
 #include "em_gpio.h"
+#include "em_timer.h"
+#include "em_cmu.h"
 
 /* The developer's include statements */
 #include "brd_config.h"
+#include "sleep_routines.h"
+#include "ldma.h"
 
 
 
@@ -34,6 +38,17 @@
 #define	RGB_PWM_PERIOD	20
 #define RGB_PWM_ACTIVE	1
 
+//Hardware PWM of the color lines, see rgb_pwm_open()
+#define RGB_PWM_TIMER     TIMER1
+#define RGB_PWM_CLOCK     cmuClock_TIMER1
+#define RGB_PWM_PRESCALE  timerPrescale64   // about 1.2 kHz from a 19 MHz HFPERCLK, well above visible flicker
+#define RGB_PWM_TOP       255               // the compare value is the 8 bit brightness
+#define RGB_PWM_EM        EM2               // TIMER1 and the LDMA run from HF clocks
+#define RGB_COLORS        3                 // red, green and blue, on CC0, CC1 and CC2
+#define RGB_LEVEL_ON      RGB_PWM_TOP       // brightness leds_enabled() turns a color on at
+#define RGB_FADE_STEPS    32                // brightness steps of a fade, one LDMA descriptor each
+#define RGB_FADE_HOLD_MAX 2048              // PWM periods one step can last, the longest LDMA transfer
+
 
 //***********************************************************************************
 // global variables
@@ -45,5 +60,10 @@
 //***********************************************************************************
 void rgb_init(void);
 void leds_enabled(uint32_t leds, uint32_t color, bool enable);
+void rgb_pwm_open(void);
+void rgb_level_set(uint32_t color, uint32_t level);
+bool rgb_fade_start(uint32_t color, uint32_t level, uint32_t ms);
+uint32_t rgb_level_get(uint32_t color);
+void rgb_service(void);
 
 #endif
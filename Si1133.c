@@ -11,27 +11,81 @@
 
 
 
-static uint32_t read_data_si1133;
+static uint8_t si1133_read_buf[SI1133_HOSTOUT_BYTES]; //bytes of the last register read, in bus order
+static uint32_t si1133_read_len;
+static uint32_t si1133_read_skip; //leading bytes of the read that are not part of the value, such as IRQ_STATUS
+static uint32_t si1133_value_len; //bytes send_si1133_data() assembles after the skipped ones
+static uint32_t si1133_channel_count = 1; //channels in CHAN_LIST, tracked by si1133_param_cache()
+static uint8_t si1133_channel_bytes[SI1133_MAX_CHANNELS] = { NUM_READ_TWO }; //HOSTOUT bytes of each channel
+static SI1133_CHANNEL_CONFIG si1133_channels[SI1133_MAX_CHANNELS] = { { WHITE_COLOR, 0, 0, 0 } }; //configuration as last written to the sensor
+static uint32_t si1133_read_time; //letimer_time_get() when the last read was started
+
+static const SI1133_INIT_ENTRY *si1133_init_table; //initialization being replayed by si1133_init_step()
+static uint32_t si1133_init_count;
+static uint32_t si1133_init_index;
+static SI1133_INIT_STATE si1133_init_state = SI1133_INIT_IDLE;
+static bool si1133_init_resetting; //the write in flight is RESET_CMD_CTR rather than the table entry
+static uint32_t si1133_init_counter; //RESPONSE0 command counter as last verified
+static uint32_t si1133_init_polls;
+static uint32_t si1133_init_attempts;
+static uint32_t si1133_init_step_evt;
+static uint32_t si1133_init_ready_evt;
+static uint32_t si1133_cmd_errors; //CMD_ERR responses seen, each cleared with RESET_CMD_CTR
+static bool si1133_gated; //power is cut between samples, chosen by si1133_power_policy()
+static bool si1133_powered; //SI1133_SENSOR_EN has been set for POWER_UP_DELAY, the sensor answers on the bus
+static uint32_t si1133_sample_evt; //advances si1133_sample_step(), given to si1133_i2c_open()
+static SI1133_SAMPLE_STATE si1133_sample_state = SI1133_SAMPLE_IDLE;
+static uint32_t si1133_sample_cb; //event posted with the result of si1133_measure() or si1133_gated_sample()
+static uint32_t si1133_sample_time; //letimer_time_get() at the end of the conversion in progress
+static SI1133_INIT_ENTRY si1133_replay[SI1133_REPLAY_ENTRIES]; //cached configuration rebuilt after each power up
+
+//Lux polynomial, high range terms then low range terms
+static const SI1133_COEFF si1133_lux_high[SI1133_NUMCOEFF_HIGH] = {
+    {     0, 209 }, {  1665, 93  }, {  2064, 65  }, { -2671, 234 }
+};
+static const SI1133_COEFF si1133_lux_low[SI1133_NUMCOEFF_LOW] = {
+    {     0, 0     }, {  1921, 29053 }, { -1022, 36363 }, {  2320, 20789 }, {  -367, 57909 },
+    { -1774, 38240 }, {  -608, 46775 }, { -1503, 51831 }, { -1886, 58928 }
+};
+static const SI1133_COEFF si1133_uv[SI1133_UV_NUMCOEFF] = {
+    {  1281, 30902 }, {  -638, 46301 }
+};
 static uint32_t si1133_write_data;
 uint32_t si1133_i2c_address = 0x55; //The Si1133 responds to the I2C address of 0x55 (from Si1133 datasheet)
 
-static void si1133_configure();
+static bool si1133_transfer(const uint8_t *write_buf, uint32_t write_len, uint8_t *read_buf, uint32_t read_len, uint32_t cb);
+static void si1133_param_set_async(uint32_t param, uint32_t value);
+static void si1133_param_cache(uint32_t param, uint32_t value);
+static void si1133_init_issue(void);
+static void si1133_init_reset(void);
+static void si1133_init_retry(void);
+static void si1133_hostout_read(uint32_t cb);
+static void si1133_gate_replay(void);
+static void si1133_convert_wait(void);
+static int32_t si1133_poly_inner(int32_t input, int32_t fraction, uint32_t mag, int32_t shift);
+static int32_t si1133_poly_eval(int32_t x, int32_t y, uint32_t input_fraction, uint32_t output_fraction, uint32_t num_coeff, const SI1133_COEFF *kp);
 /***************************************************************************//**
  * @brief
  * Si1133 driver/initialization function
  *
  * @details
- * Initializes all the I2C_OPEN_STRUCT values and sends the values to the i2c_open() function.
+ * Initializes all the I2C_OPEN_STRUCT values and sends the values to the i2c_open() function. The sensor itself
+ * is powered up and configured afterwards by si1133_init_start(), without blocking.
  *
  * @note
  *  This function will call the i2c_open, where the input will be the I2C peripheral(I2C0 or I2C1) and the sensor values. This happens in app.c.
+ *
+ * @param[in] service_evt
+ *  Scheduled event whose callback runs i2c_service(), posted when an I2C timeout, retry or bus reset is due
+ *
+ * @param[in] sample_evt
+ *  Scheduled event whose callback runs si1133_sample_step(), posted as a forced measurement moves on
  ******************************************************************************/
-void si1133_i2c_open() {
-
-  timer_delay(POWER_UP_DELAY);
-
+void si1133_i2c_open(uint32_t service_evt, uint32_t sample_evt) {
   I2C_OPEN_STRUCT si_sensor_vals;
 
+  si1133_sample_evt = sample_evt;
+
   si_sensor_vals.enable = true;
   si_sensor_vals.master = true;
   si_sensor_vals.freq = I2C_FREQ_FAST_MAX;
@@ -41,19 +95,19 @@ void si1133_i2c_open() {
   si_sensor_vals.scl_route = I2C_SCL;
   si_sensor_vals.sda_route = I2C_SDA;
   si_sensor_vals.clhr = i2cClockHLRAsymetric;
+  si_sensor_vals.ldma_en = true;
+  si_sensor_vals.service_cb = service_evt;
   i2c_open(I2C1, &si_sensor_vals);
-
-  si1133_configure();
 }
 
 
 /***************************************************************************//**
  * @brief
- * The Si1133_read()function calls the i2c_start() function with needed input parameters. Through this function, we are allowing the Si1133 to send values to the master.
+ * The Si1133_read()function calls the i2c_transfer() function with needed input parameters. Through this function, we are allowing the Si1133 to send values to the master.
  *
  * @details
- * The i2c_start is called with the scheduled event callback,the register address, dereferenced pointer that contains the read data, the specific I2Cx peripheral we want, the number of bytes
- * that will be incoming to the master and either if its a READ or WRITE operation.
+ * The register address is written as a one byte write, followed by a repeated START and the read of number_bytes
+ * into the driver read buffer. send_si1133_data() assembles them into a value once the callback has been scheduled.
  *
  * @note
  * The input parameters in this function are the register address, number of bytes to receive from Si1133 and the scheduled event callback
@@ -67,11 +121,19 @@ void si1133_i2c_open() {
  * @param[in] cb
  * Requests the read of of the Si1133 Part ID.
  *
+ * @return
+ *  false if the I2C queue was full; cb has then been posted already and si1133_transfer_ok(cb) reports the failure
  ******************************************************************************/
 
-void Si1133_read(uint32_t reg_addy,uint32_t number_bytes, uint32_t cb) {
+bool Si1133_read(uint32_t reg_addy,uint32_t number_bytes, uint32_t cb) {
 
-  i2c_start(I2C1, si1133_i2c_address, reg_addy, READ_OP, cb, &read_data_si1133, number_bytes);
+  uint8_t reg = reg_addy;
+  EFM_ASSERT(number_bytes <= sizeof(si1133_read_buf));
+  si1133_read_len = number_bytes;
+  si1133_read_skip = 0;
+  si1133_value_len = number_bytes;
+  si1133_read_time = letimer_time_get();
+  return si1133_transfer(&reg, 1, si1133_read_buf, number_bytes, cb);
 
 }
 
@@ -80,11 +142,11 @@ void Si1133_read(uint32_t reg_addy,uint32_t number_bytes, uint32_t cb) {
 
 /***************************************************************************//**
  * @brief
- * The Si1133_write()function calls the i2c_start() function with needed input parameters. Through this function, we are requesting the Si1133 to send values to the master.
+ * The Si1133_write()function calls the i2c_transfer() function with needed input parameters. Through this function, we are requesting the Si1133 to send values to the master.
  *
  * @details
- * The i2c_start is called with the scheduled event callback,the register address, dereferenced pointer that contains the read data, the specific I2Cx peripheral we want, the number of bytes
- * that will be outgoing to the slave and either if its a READ or WRITE operation. In this case we are using WRITE_OP, which is being used as a write operation.
+ * One write buffer holds the register address followed by number_bytes of si1133_write_data, least significant byte
+ * first, matching the auto incrementing register layout of the Si1133.
  *
  * @note
  * The input parameters in this function are the register address, number of bytes to write to the Si1133 and the scheduled event callback
@@ -98,74 +160,68 @@ void Si1133_read(uint32_t reg_addy,uint32_t number_bytes, uint32_t cb) {
  * @param[in] cb
  * Callbacks shouldn't be serviced in the write operation.
  *
+ * @return
+ *  false if the I2C queue was full, as for Si1133_read()
  ******************************************************************************/
-void Si1133_write(uint32_t reg_addy, uint32_t number_bytes, uint32_t cb) {
+bool Si1133_write(uint32_t reg_addy, uint32_t number_bytes, uint32_t cb) {
 
-  i2c_start(I2C1, si1133_i2c_address, reg_addy, WRITE_OP, cb, &si1133_write_data, number_bytes);
+  uint8_t buf[1 + sizeof(si1133_write_data)];
+  EFM_ASSERT(number_bytes <= sizeof(si1133_write_data));
+  buf[0] = reg_addy;
+  for (uint32_t i = 0; i < number_bytes; i++) {
+      buf[1 + i] = si1133_write_data >> (BIT_SHIFT_EIGHT * i);
+  }
+  return si1133_transfer(buf, 1 + number_bytes, NULL, 0, cb);
 
 }
 
+/***************************************************************************//**
+ * @brief
+ * Submits one Si1133 transaction on I2C1 and turns a refusal into a failed transaction.
+ *
+ * @details
+ * A full I2C queue refuses the transfer and would never post cb. Posting it here as I2C_STATUS_REFUSED
+ * instead lets every asynchronous step of the driver take a refusal the way it takes a NACK or a
+ * timeout, through si1133_transfer_ok(), rather than waiting for an event that does not come.
+ ******************************************************************************/
+bool si1133_transfer(const uint8_t *write_buf, uint32_t write_len, uint8_t *read_buf, uint32_t read_len, uint32_t cb) {
+  if (i2c_transfer(I2C1, si1133_i2c_address, write_buf, write_len, read_buf, read_len, cb)) return true;
+  i2c_event_post(cb, I2C_STATUS_REFUSED);
+  return false;
+}
 
-void si1133_configure() {
-  uint32_t cmd_ctr;
-  uint32_t cmd_ctr_new;
-  uint32_t cmd_ctr_new2;
-  uint32_t cmd_ctr_masked;
-  uint32_t cmd_ctr_masked2;
-  //Lab Flow start
-  Si1133_read(RESPONSE0, NUM_READ, NULL_CB); // read RESPONSE0 reg
-  while(is_busy());//1
-  cmd_ctr = read_data_si1133 & MASK_BIT;
-  si1133_write_data = WHITE_COLOR;
-  Si1133_write(INPUT0, NUM_READ, NULL_CB);
-  while(is_busy());
-  si1133_write_data = PARAMTABLE_WRT | ADCCONFIG0;
-  Si1133_write(COMMANDREG, NUM_READ, NULL_CB);
-  while(is_busy());
-  Si1133_read(RESPONSE0, NUM_READ, NULL_CB);
-  while(is_busy());
-  cmd_ctr_masked = (cmd_ctr + 1) & MASK_BIT;
-  cmd_ctr_new = read_data_si1133 & MASK_BIT;
-  if (cmd_ctr_new != cmd_ctr_masked) {
-      EFM_ASSERT(false);
-  }
-  else {
-      si1133_write_data = CHANNEL0;
-      Si1133_write(INPUT0, NUM_READ, NULL_CB);
-      while(is_busy());
-      si1133_write_data = PARAMTABLE_WRT | CHAN_LIST;
-      Si1133_write(COMMANDREG, NUM_READ, NULL_CB);
-      while(is_busy());
-      Si1133_read(RESPONSE0, NUM_READ, NULL_CB);
-      while(is_busy());
-      cmd_ctr_masked2 = (cmd_ctr + 2) & MASK_BIT;
-      cmd_ctr_new2 = read_data_si1133 & MASK_BIT;
-      if(cmd_ctr_new2 != cmd_ctr_masked2) {
-          EFM_ASSERT(false);
-      }
-      else {
-          return;
-      }
-  }
-
+/***************************************************************************//**
+ * @brief
+ * Tells from a callback whether the Si1133 transaction behind it was accepted and completed without error.
+ *
+ * @param[in] cb
+ *  The event being handled, as passed with the transaction
+ ******************************************************************************/
+bool si1133_transfer_ok(uint32_t cb) {
+  return i2c_status_get(cb) == I2C_STATUS_OK;
+}
 
-  }
 
 /***************************************************************************//**
  * @brief
- * The send_si1133_data() function returns the read_data_si1133 to wherever it is called.
+ * The send_si1133_data() function returns the value of the last Si1133_read() to wherever it is called.
  *
  * @details
- * The primary reason for this function is to be used in the scheduled callback function in app.c. The read_data_si1133 should be the Part ID response from our slave.
+ * The primary reason for this function is to be used in the scheduled callback function in app.c. The bytes are assembled
+ * most significant first, the order the HOSTOUT registers hold a measurement in.
  *
  * @note
- *  This value will be used in app.c to either turn the LED on or off depending on if the read_data_si1133 is matching the expected data.
+ *  This value will be used in app.c to either turn the LED on or off depending on if the value read is matching the expected data.
  *
- * @param[out] read_data_si1133
- *  read_data_si1133 is being sent out to any function that calls it, in this case the scheduled_si1133_read_cb(void) in app.c is calling this function.
+ * @param[out] value
+ *  The value read is being sent out to any function that calls it, in this case the scheduled_si1133_read_cb(void) in app.c is calling this function.
  ******************************************************************************/
 uint32_t send_si1133_data() {
-  return read_data_si1133;
+  uint32_t value = 0;
+  for (uint32_t i = si1133_read_skip; i < si1133_read_skip + si1133_value_len; i++) {
+      value = (value << BIT_SHIFT_EIGHT) | si1133_read_buf[i];
+  }
+  return value;
 }
 
 /***************************************************************************//**
@@ -176,11 +232,12 @@ uint32_t send_si1133_data() {
  * This function is being used as an initialization to get the Si1133 readings. It initiates a set of measurements within the CHAN_LIST parameter.
  *
  * @note
+ *  Returns false if the I2C queue was full and no FORCE went out.
  *
  ******************************************************************************/
-void force_send() {
+bool force_send() {
   si1133_write_data = FORCE_CMD;
-  Si1133_write(COMMANDREG, NUM_READ, NULL_CB);
+  return Si1133_write(COMMANDREG, NUM_READ, NULL_CB);
 }
 
 /***************************************************************************//**
@@ -195,6 +252,759 @@ void force_send() {
  *
  ******************************************************************************/
 void request_res() {
-  Si1133_read(HOSTOUT0, NUM_READ_TWO, I2C_CB);
+  si1133_hostout_read(I2C_CB);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Reads the results of every configured channel from HOSTOUT0 on in one transaction.
+ ******************************************************************************/
+void si1133_hostout_read(uint32_t cb) {
+  uint32_t hostout_bytes = 0;
+
+  for (uint32_t i = 0; i < si1133_channel_count; i++) hostout_bytes += si1133_channel_bytes[i];
+  Si1133_read(HOSTOUT0, hostout_bytes, cb);
+  si1133_value_len = si1133_channel_bytes[0]; //channel 0 for send_si1133_data(), the rest for si1133_channel_get()
+}
+
+
+/***************************************************************************//**
+ * @brief
+ * Reads number_bytes consecutive Si1133 registers starting at reg_addy into a caller buffer in a single transfer.
+ *
+ * @details
+ * Used for the HOSTOUT block, where every enabled channel leaves its result in consecutive registers. The buffer
+ * must stay valid until the callback event has been scheduled.
+ *
+ * @param[in] reg_addy
+ *  First register to read
+ *
+ * @param[out] buf
+ *  Destination of the register contents, in register order
+ *
+ * @param[in] number_bytes
+ *  Number of registers to read, at most SI1133_HOSTOUT_BYTES
+ *
+ * @param[in] cb
+ *  Scheduled event posted once the read has completed, or at once if the I2C queue was full
+ ******************************************************************************/
+bool si1133_burst_read(uint32_t reg_addy, uint8_t *buf, uint32_t number_bytes, uint32_t cb) {
+  uint8_t reg = reg_addy;
+  EFM_ASSERT(number_bytes <= SI1133_HOSTOUT_BYTES);
+  return si1133_transfer(&reg, 1, buf, number_bytes, cb);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Reads IRQ_STATUS and the channel 0 result in one transaction after the INT pin fired.
+ *
+ * @details
+ * IRQ_STATUS sits right before HOSTOUT0, so a single burst both releases the INT pin and fetches the
+ * results of every configured channel. send_si1133_data() returns channel 0 once cb has been posted and
+ * si1133_channel_get() any channel.
+ *
+ * @param[in] cb
+ *  Scheduled event posted once the read has completed. A read refused by a full I2C queue posts it at
+ *  once as failed; INT then stays low and the once per period si1133_int_pending() check tries again.
+ ******************************************************************************/
+bool si1133_irq_read(uint32_t cb) {
+  uint8_t reg = IRQ_STATUS;
+
+  si1133_read_len = 1;
+  for (uint32_t i = 0; i < si1133_channel_count; i++) si1133_read_len += si1133_channel_bytes[i];
+  si1133_read_skip = 1;
+  si1133_value_len = si1133_channel_bytes[0];
+  si1133_read_time = letimer_time_get();
+  return si1133_transfer(&reg, 1, si1133_read_buf, si1133_read_len, cb);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true while the Si1133 holds its INT pin low.
+ *
+ * @details
+ * The GPIO interrupt only sees the falling edge; if the read that should release the pin failed, no
+ * further edge comes. The application checks this once per LETIMER period to recover.
+ ******************************************************************************/
+bool si1133_int_pending(void) {
+  return !GPIO_PinInGet(SI1133_INT_PORT, SI1133_INT_PIN);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes a parameter table entry without waiting, for use from scheduled callbacks.
+ *
+ * @details
+ * HOSTIN0 and COMMAND are consecutive registers, so the value and the PARAM_SET command go out in a
+ * single two byte write. The command counter is not checked; a sensor that stopped answering shows up as
+ * failed reads.
+ ******************************************************************************/
+void si1133_param_set_async(uint32_t param, uint32_t value) {
+  si1133_param_cache(param, value);
+  si1133_write_data = (value & 0xFF) | ((PARAMTABLE_WRT | param) << BIT_SHIFT_EIGHT);
+  Si1133_write(INPUT0, NUM_READ_TWO, NULL_CB);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Arms the threshold interrupt for the opposite of the current light state.
+ *
+ * @details
+ * While dark the interrupt waits for the result to rise above THRESHOLD1, while light for it to fall
+ * below THRESHOLD0, so every interrupt is an edge. Non blocking, called from the read callback.
+ *
+ * @param[in] dark
+ *  The light state just reported
+ ******************************************************************************/
+void si1133_threshold_arm(bool dark) {
+  uint32_t adcpost = si1133_channels[0].adcpost & ~_ADCPOST_THRESH_MASK;
+
+  adcpost |= dark ? ADCPOST_THRESH_SEL_1 : (ADCPOST_THRESH_SEL_0 | ADCPOST_THRESH_POL_BELOW);
+  si1133_param_set_async(ADCPOST0, adcpost);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Stops comparing channel 0 against the thresholds, so every measurement interrupts again.
+ ******************************************************************************/
+void si1133_threshold_disarm(void) {
+  si1133_param_set_async(ADCPOST0, si1133_channels[0].adcpost & ~_ADCPOST_THRESH_MASK);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the result of one channel from the last si1133_irq_read(), sign extended.
+ *
+ * @param[in] channel
+ *  Channel number, below the channels enabled in CHAN_LIST by the initialization table
+ ******************************************************************************/
+int32_t si1133_channel_get(uint32_t channel) {
+  uint32_t offset = si1133_read_skip;
+  uint32_t value = 0;
+
+  EFM_ASSERT(channel < si1133_channel_count);
+  for (uint32_t i = 0; i < channel; i++) offset += si1133_channel_bytes[i];
+  for (uint32_t i = 0; i < si1133_channel_bytes[channel]; i++) {
+      value = (value << BIT_SHIFT_EIGHT) | si1133_read_buf[offset + i];
+  }
+  if (si1133_channel_bytes[channel] == 3 && (value & 0x800000)) value |= 0xFF000000;
+  return (int32_t)value;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Unpacks every channel of the last HOSTOUT read into result, with the time the read was started.
+ *
+ * @details
+ * 16 and 24 bit channels are assembled from the one burst read, most significant byte first, so a
+ * single transaction serves all channels whatever their output width.
+ *
+ * @param[out] result
+ *  Channel results and timestamp
+ ******************************************************************************/
+void si1133_result_get(SI1133_RESULT *result) {
+  result->timestamp = si1133_read_time;
+  result->channels = si1133_channel_count;
+  for (uint32_t i = 0; i < si1133_channel_count; i++) result->value[i] = si1133_channel_get(i);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sets the oversampling of one channel inside the sensor.
+ *
+ * @details
+ * DECIM_RATE sets how many ADC samples make up one conversion, 0 being 1024, then 2048, 4096 and
+ * 512. SW_GAIN accumulates 2^sw_gain conversions into one result, which lowers the noise by
+ * sqrt(2^sw_gain) at the cost of a conversion time 2^sw_gain times longer, with no extra bus
+ * traffic. The accumulated result grows by the same factor, so a channel with a large SW_GAIN
+ * wants the 24 bit output or a POSTSHIFT in ADCPOST. Non blocking, the parameter writes are queued
+ * on the I2C bus.
+ *
+ * @param[in] channel
+ *  Channel number, below the channels enabled in CHAN_LIST by the initialization table
+ *
+ * @param[in] decim_rate
+ *  DECIM_RATE field, 0 to SI1133_DECIM_MAX
+ *
+ * @param[in] sw_gain
+ *  SW_GAIN field, 0 to SI1133_SW_GAIN_MAX
+ ******************************************************************************/
+void si1133_oversampling_set(uint32_t channel, uint32_t decim_rate, uint32_t sw_gain) {
+  SI1133_CHANNEL_CONFIG *config = &si1133_channels[channel];
+  uint32_t base = ADCCONFIG0 + SI1133_CHANNEL_PARAMS * channel;
+
+  EFM_ASSERT(channel < si1133_channel_count);
+  EFM_ASSERT(decim_rate <= SI1133_DECIM_MAX && sw_gain <= SI1133_SW_GAIN_MAX);
+  si1133_param_set_async(base, (config->adcconfig & ~_ADCCONFIG_DECIM_MASK) | (decim_rate << _ADCCONFIG_DECIM_SHIFT));
+  si1133_param_set_async(base + 1, (config->adcsens & ~_ADCSENS_SW_GAIN_MASK) | (sw_gain << _ADCSENS_SW_GAIN_SHIFT));
+}
+
+/***************************************************************************//**
+ * @brief
+ * One factor of a polynomial term: the input in fixed point divided by the term magnitude, then scaled.
+ ******************************************************************************/
+int32_t si1133_poly_inner(int32_t input, int32_t fraction, uint32_t mag, int32_t shift) {
+  int32_t value = (input << fraction) / (int32_t)mag;
+
+  if (shift < 0) return value >> -shift;
+  return value << shift;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Evaluates the datasheet polynomial in x and y, integer only.
+ *
+ * @details
+ * Each term carries its sign, the order of x and of y (0 to 2) and a power of two scale in its info
+ * word. The result is returned with output_fraction fractional bits.
+ ******************************************************************************/
+int32_t si1133_poly_eval(int32_t x, int32_t y, uint32_t input_fraction, uint32_t output_fraction, uint32_t num_coeff, const SI1133_COEFF *kp) {
+  int32_t output = 0;
+
+  for (uint32_t i = 0; i < num_coeff; i++, kp++) {
+      uint32_t info = kp->info & 0xFF;
+      uint32_t x_order = (info >> 4) & 0x07;
+      uint32_t y_order = info & 0x07;
+      int32_t sign = (info & 0x80) ? -1 : 1;
+      int32_t shift = (int8_t)((uint16_t)kp->info >> BIT_SHIFT_EIGHT);
+      int32_t x1 = 1, x2 = 1, y1 = 1, y2 = 1;
+
+      if (x_order == 0 && y_order == 0) {
+          output += (sign * (int32_t)kp->mag) << output_fraction;
+          continue;
+      }
+      if (x_order > 0) {
+          x1 = si1133_poly_inner(x, input_fraction, kp->mag, shift);
+          if (x_order > 1) x2 = x1;
+      }
+      if (y_order > 0) {
+          y1 = si1133_poly_inner(y, input_fraction, kp->mag, shift);
+          if (y_order > 1) y2 = y1;
+      }
+      output += sign * x1 * x2 * y1 * y2;
+  }
+  return (output < 0) ? -output : output;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Computes the illuminance in lux, Q12, from the visible and IR channel results.
+ *
+ * @details
+ * Bright light, where the normal range visible channel or the IR channel pass SI1133_ADC_THRESHOLD,
+ * uses the high range visible channel and the short polynomial; otherwise the low range one. No floating
+ * point is involved, the result divided by 4096 is the lux value.
+ *
+ * @param[in] vis_high
+ *  High signal range visible channel
+ *
+ * @param[in] vis_low
+ *  Normal range visible channel
+ *
+ * @param[in] ir
+ *  IR channel
+ ******************************************************************************/
+int32_t si1133_lux_get(int32_t vis_high, int32_t vis_low, int32_t ir) {
+  if (vis_high > SI1133_ADC_THRESHOLD || ir > SI1133_ADC_THRESHOLD) {
+      return si1133_poly_eval(vis_high, ir, SI1133_INPUT_FRACTION_HIGH, SI1133_LUX_FRACTION, SI1133_NUMCOEFF_HIGH, si1133_lux_high);
+  }
+  return si1133_poly_eval(vis_low, ir, SI1133_INPUT_FRACTION_LOW, SI1133_LUX_FRACTION, SI1133_NUMCOEFF_LOW, si1133_lux_low);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Computes the UV index, Q12, from the UV channel result.
+ ******************************************************************************/
+int32_t si1133_uvi_get(int32_t uv) {
+  return si1133_poly_eval(0, uv, SI1133_UV_INPUT_FRACTION, SI1133_UV_FRACTION, SI1133_UV_NUMCOEFF, si1133_uv);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Keeps the driver copy of the channel configuration in step with a parameter write.
+ *
+ * @details
+ * Every path that writes the parameter table goes through here, so si1133_channel_get() knows the
+ * width of each result and the threshold and oversampling setters can change a field without reading
+ * the parameter back. CHAN_LIST is expected to enable channels 0 to n - 1.
+ ******************************************************************************/
+void si1133_param_cache(uint32_t param, uint32_t value) {
+  if (param >= ADCCONFIG0 && param < ADCCONFIG0 + SI1133_CHANNEL_PARAMS * SI1133_MAX_CHANNELS) {
+      uint32_t channel = (param - ADCCONFIG0) / SI1133_CHANNEL_PARAMS;
+      SI1133_CHANNEL_CONFIG *config = &si1133_channels[channel];
+
+      switch ((param - ADCCONFIG0) % SI1133_CHANNEL_PARAMS) {
+        case 0:
+          config->adcconfig = value;
+          break;
+        case 1:
+          config->adcsens = value;
+          break;
+        case 2:
+          config->adcpost = value;
+          si1133_channel_bytes[channel] = (value & ADCPOST_24BIT) ? 3 : 2;
+          break;
+        default:
+          config->measconfig = value;
+          break;
+      }
+  }
+  else if (param == CHAN_LIST) {
+      EFM_ASSERT(value != 0 && (value & (value + 1)) == 0);
+      si1133_channel_count = 0;
+      while (value >> si1133_channel_count) si1133_channel_count++;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts replaying an initialization table on the Si1133 without blocking.
+ *
+ * @details
+ * The table is a list of parameter writes, register writes and commands, written one per I2C
+ * transaction. Each completion posts step_evt, whose handler calls si1133_init_step() to check the
+ * result and issue the next entry, so the MCU sleeps or serves other events while the sensor is
+ * configured. A sensor whose supply just came up, at boot or for a gated sample, is first given
+ * POWER_UP_DELAY through an RTCC event, which leaves TIMER0 to timer_delay() and the MCU in EM2. The command counter is reset first so every PARAM_SET and
+ * command is checked against a known RESPONSE0 value. ready_evt is posted once the whole table has been written, or the
+ * initialization gave up; si1133_ready() tells which.
+ *
+ * @param[in] table
+ *  Initialization entries, kept valid until ready_evt is posted
+ *
+ * @param[in] count
+ *  Number of entries
+ *
+ * @param[in] step_evt
+ *  Scheduled event posted on each completed transaction of the initialization
+ *
+ * @param[in] ready_evt
+ *  Scheduled event posted when the initialization has finished
+ ******************************************************************************/
+void si1133_init_start(const SI1133_INIT_ENTRY *table, uint32_t count, uint32_t step_evt, uint32_t ready_evt) {
+  si1133_init_table = table;
+  si1133_init_count = count;
+  si1133_init_index = 0;
+  si1133_init_attempts = 0;
+  si1133_init_step_evt = step_evt;
+  si1133_init_ready_evt = ready_evt;
+  if (!si1133_powered) {
+      si1133_init_state = SI1133_INIT_POWERUP;
+      rtcc_event(RTCC_CH_SI1133, POWER_UP_DELAY, step_evt);
+      return;
+  }
+  si1133_init_reset();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Advances the initialization after one of its transactions completed.
+ *
+ * @details
+ * A written parameter or command is followed by a read of RESPONSE0. The entry is done once the
+ * counter moved by one. CMD_ERR, a counter that does not move after SI1133_INIT_POLLS reads or a failed
+ * transaction clears the counter with RESET_CMD_CTR and writes the entry again, at most
+ * SI1133_INIT_ATTEMPTS times before the initialization is declared failed.
+ ******************************************************************************/
+void si1133_init_step(void) {
+  const SI1133_INIT_ENTRY *entry = &si1133_init_table[si1133_init_index];
+  uint32_t response = si1133_read_buf[0];
+  uint32_t expected = si1133_init_resetting ? 0 : ((si1133_init_counter + 1) & MASK_BIT);
+
+  if (si1133_init_state == SI1133_INIT_POWERUP) { //the RTCC event, no transaction behind it
+      si1133_powered = true;
+      si1133_init_reset();
+      return;
+  }
+  if (!si1133_transfer_ok(si1133_init_step_evt)) { //NACK, timeout or a full I2C queue
+      si1133_init_retry();
+      return;
+  }
+  switch (si1133_init_state) {
+    case SI1133_INIT_WRITE:
+      if (!si1133_init_resetting && entry->op == SI1133_INIT_REG) {
+          si1133_init_index++;
+          si1133_init_attempts = 0;
+          si1133_init_issue();
+          return;
+      }
+      si1133_init_state = SI1133_INIT_VERIFY;
+      si1133_init_polls = 0;
+      Si1133_read(RESPONSE0, NUM_READ, si1133_init_step_evt);
+      break;
+    case SI1133_INIT_VERIFY:
+      if (response & RESPONSE0_CMD_ERR) {
+          si1133_cmd_errors++;
+          si1133_init_retry();
+      }
+      else if ((response & MASK_BIT) == expected) {
+          si1133_init_counter = expected;
+          if (si1133_init_resetting) {
+              si1133_init_resetting = false;
+          }
+          else {
+              si1133_init_index++;
+              si1133_init_attempts = 0;
+          }
+          si1133_init_issue();
+      }
+      else if (++si1133_init_polls < SI1133_INIT_POLLS) {
+          Si1133_read(RESPONSE0, NUM_READ, si1133_init_step_evt);
+      }
+      else {
+          si1133_init_retry();
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes the current table entry, or finishes the initialization after the last one.
+ ******************************************************************************/
+void si1133_init_issue(void) {
+  const SI1133_INIT_ENTRY *entry = &si1133_init_table[si1133_init_index];
+
+  if (si1133_init_index == si1133_init_count) {
+      si1133_init_state = SI1133_INIT_DONE;
+      if (si1133_sample_state == SI1133_SAMPLE_CONFIG) { //FORCE was the last entry
+          si1133_convert_wait();
+          return;
+      }
+      add_scheduled_event(si1133_init_ready_evt);
+      return;
+  }
+  si1133_init_state = SI1133_INIT_WRITE;
+  switch (entry->op) {
+    case SI1133_INIT_PARAM:
+      si1133_param_cache(entry->addr, entry->value);
+      si1133_write_data = entry->value | ((PARAMTABLE_WRT | entry->addr) << BIT_SHIFT_EIGHT);
+      Si1133_write(INPUT0, NUM_READ_TWO, si1133_init_step_evt);
+      break;
+    case SI1133_INIT_REG:
+      si1133_write_data = entry->value;
+      Si1133_write(entry->addr, NUM_READ, si1133_init_step_evt);
+      break;
+    default:
+      si1133_write_data = entry->addr;
+      Si1133_write(COMMANDREG, NUM_READ, si1133_init_step_evt);
+      break;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes RESET_CMD_CTR, which clears CMD_ERR and sets the command counter back to 0.
+ ******************************************************************************/
+void si1133_init_reset(void) {
+  si1133_init_state = SI1133_INIT_WRITE;
+  si1133_init_resetting = true;
+  si1133_write_data = RESET_CMD_CTR;
+  Si1133_write(COMMANDREG, NUM_READ, si1133_init_step_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts the current entry over after a reset of the command counter, or gives up.
+ ******************************************************************************/
+void si1133_init_retry(void) {
+  if (++si1133_init_attempts >= SI1133_INIT_ATTEMPTS) {
+      si1133_init_state = SI1133_INIT_FAILED;
+      if (si1133_sample_state != SI1133_SAMPLE_IDLE) {
+          GPIO_PinOutClear(SI1133_SENSOR_EN_PORT, SI1133_SENSOR_EN_PIN);
+          si1133_powered = false;
+          si1133_sample_state = SI1133_SAMPLE_IDLE;
+      }
+      add_scheduled_event(si1133_init_ready_evt);
+      return;
+  }
+  si1133_init_reset();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true once an initialization table has been written completely.
+ ******************************************************************************/
+bool si1133_ready(void) {
+  return si1133_init_state == SI1133_INIT_DONE;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the number of CMD_ERR responses the initialization has recovered from or failed on.
+ ******************************************************************************/
+uint32_t si1133_cmd_errors_get(void) {
+  return si1133_cmd_errors;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Routes the Si1133 INT pin to a falling edge GPIO interrupt posting int_evt.
+ ******************************************************************************/
+void si1133_int_open(uint32_t int_evt) {
+  gpio_int_open(SI1133_INT_PORT, SI1133_INT_PIN, false, true, int_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Has the FORCE command written by the I2C1 trigger loop on every rising edge of a PRS channel.
+ *
+ * @details
+ * Nothing runs on the CPU to start a measurement; it wakes on the INT pin only, to read the result
+ * with si1133_irq_read(). IRQ_ENABLE has to select the last channel of CHAN_LIST so the pin falls
+ * once all of them are done. The sensor has to stay powered; gating needs the CPU to replay the
+ * configuration for every sample.
+ *
+ * @param[in] prs_ch
+ *  PRS channel carrying the trigger, see letimer_prs_open()
+ *
+ * @param[in] int_evt
+ *  Scheduled event posted when a measurement is ready
+ ******************************************************************************/
+void si1133_trigger_open(uint32_t prs_ch, uint32_t int_evt) {
+  static const uint8_t force_write[] = { COMMANDREG, FORCE_CMD };
+
+  EFM_ASSERT(!si1133_gated);
+  si1133_int_open(int_evt);
+  i2c_trigger_write_open(I2C1, si1133_i2c_address, force_write, sizeof(force_write), prs_ch);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Average current of the sensor supply for one sample every period_ms, powered all the time or gated.
+ *
+ * @details
+ * Always on, the sensor idles at SI1133_STANDBY_NA between samples. Gated, it draws nothing between
+ * samples, but each sample pays for the sensor booting through POWER_UP_DELAY and the transactions
+ * that replay the configuration. The power up is timed by the RTCC, so the MCU sleeps in EM2 through
+ * it as it would between samples anyway and adds nothing. The measurement itself costs the same
+ * either way and is left out. With the five lux and UV channels gating wins above about 12.5 s.
+ *
+ * @param[in] period_ms
+ *  Sample period in milliseconds
+ *
+ * @param[out] on_na
+ *  Average current with the sensor always powered, nA
+ *
+ * @param[out] gated_na
+ *  Average current with the sensor powered for each sample only, nA
+ ******************************************************************************/
+void si1133_power_model(uint32_t period_ms, uint32_t *on_na, uint32_t *gated_na) {
+  uint32_t transactions = 2 + 2 * (SI1133_CHANNEL_PARAMS * si1133_channel_count + 2) + 1; //reset, entries, read
+  uint64_t charge = (uint64_t)SI1133_BOOT_NA * POWER_UP_DELAY + (uint64_t)transactions * SI1133_TRANSACTION_NAMS;
+
+  EFM_ASSERT(period_ms > 0);
+  *on_na = SI1133_STANDBY_NA;
+  *gated_na = charge / period_ms;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Picks power gating or an always powered sensor for a sample period, whichever the model finds cheaper.
+ *
+ * @details
+ * Applies to forced measurements only; in autonomous mode the sensor times itself and stays powered.
+ * With gating chosen the sensor is switched off until the next si1133_gated_sample(). Back on an
+ * always powered sensor, the next si1133_measure() powers it up and replays the configuration first.
+ * A sample in progress keeps its supply and applies the choice when it ends. Call once the
+ * initialization is done and whenever the sample period changes.
+ *
+ * @param[in] period_ms
+ *  Sample period in milliseconds
+ *
+ * @return
+ *  true when gating was chosen
+ ******************************************************************************/
+bool si1133_power_policy(uint32_t period_ms) {
+  uint32_t on_na, gated_na;
+
+  si1133_power_model(period_ms, &on_na, &gated_na);
+  si1133_gated = gated_na < on_na;
+  if (si1133_sample_state != SI1133_SAMPLE_IDLE) return si1133_gated; //si1133_sample_step() switches the supply
+  if (si1133_gated) {
+      GPIO_PinOutClear(SI1133_SENSOR_EN_PORT, SI1133_SENSOR_EN_PIN);
+      si1133_powered = false;
+  }
+  else {
+      GPIO_PinOutSet(SI1133_SENSOR_EN_PORT, SI1133_SENSOR_EN_PIN);
+  }
+  return si1133_gated;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true when the sensor is power gated between samples.
+ ******************************************************************************/
+bool si1133_power_gated(void) {
+  return si1133_gated;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true when no si1133_measure() or si1133_gated_sample() is in progress.
+ ******************************************************************************/
+bool si1133_sample_idle(void) {
+  return si1133_sample_state == SI1133_SAMPLE_IDLE;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Takes one sample with the sensor powered only for it.
+ *
+ * @details
+ * Sets SI1133_SENSOR_EN and replays the cached channel configuration followed by FORCE through the
+ * initialization state machine, which first waits POWER_UP_DELAY. HOSTOUT is then read by
+ * si1133_sample_step() once si1133_conversion_us() has passed, and the sensor is switched off again
+ * before cb is posted. Nothing blocks.
+ *
+ * @param[in] cb
+ *  Scheduled event posted with the result, read as for request_res()
+ ******************************************************************************/
+void si1133_gated_sample(uint32_t cb) {
+  EFM_ASSERT(si1133_gated && si1133_sample_idle());
+  si1133_sample_cb = cb;
+  GPIO_PinOutSet(SI1133_SENSOR_EN_PORT, SI1133_SENSOR_EN_PIN);
+  si1133_gate_replay();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Rebuilds the parameter writes of the cached configuration with a FORCE behind them and replays them.
+ ******************************************************************************/
+void si1133_gate_replay(void) {
+  uint32_t n = 0;
+
+  for (uint32_t i = 0; i < si1133_channel_count; i++) {
+      uint32_t base = ADCCONFIG0 + SI1133_CHANNEL_PARAMS * i;
+      si1133_replay[n++] = (SI1133_INIT_ENTRY)SI1133_PARAM(base, si1133_channels[i].adcconfig);
+      si1133_replay[n++] = (SI1133_INIT_ENTRY)SI1133_PARAM(base + 1, si1133_channels[i].adcsens);
+      si1133_replay[n++] = (SI1133_INIT_ENTRY)SI1133_PARAM(base + 2, si1133_channels[i].adcpost);
+      si1133_replay[n++] = (SI1133_INIT_ENTRY)SI1133_PARAM(base + 3, si1133_channels[i].measconfig);
+  }
+  si1133_replay[n++] = (SI1133_INIT_ENTRY)SI1133_PARAM(CHAN_LIST, (1 << si1133_channel_count) - 1);
+  si1133_replay[n++] = (SI1133_INIT_ENTRY)SI1133_CMD(FORCE_CMD);
+  si1133_sample_state = SI1133_SAMPLE_CONFIG;
+  si1133_init_start(si1133_replay, n, si1133_init_step_evt, si1133_init_ready_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns how long one FORCE takes to measure every channel of CHAN_LIST, in microseconds.
+ *
+ * @details
+ * Computed from the cached ADCCONFIG and ADCSENS of each channel: 24.4 us * 2^HW_GAIN per
+ * measurement, scaled by DECIM_RATE and repeated 2^SW_GAIN times, plus SI1133_CONVERT_OVERHEAD_US
+ * and SI1133_CONVERT_MARGIN_PCT for the tolerance of the ADC clock. It follows every parameter
+ * write, si1133_oversampling_set() included.
+ ******************************************************************************/
+uint32_t si1133_conversion_us(void) {
+  uint64_t total_ns = 0;
+
+  for (uint32_t i = 0; i < si1133_channel_count; i++) {
+      uint32_t decim = (si1133_channels[i].adcconfig & _ADCCONFIG_DECIM_MASK) >> _ADCCONFIG_DECIM_SHIFT;
+      uint32_t sw_gain = (si1133_channels[i].adcsens & _ADCSENS_SW_GAIN_MASK) >> _ADCSENS_SW_GAIN_SHIFT;
+      uint32_t hw_gain = si1133_channels[i].adcsens & _ADCSENS_HW_GAIN_MASK;
+      uint32_t decim_halves = (decim == SI1133_DECIM_MAX) ? 1 : (2 << decim); //512 ADC clocks is half of 1024
+
+      total_ns += ((uint64_t)SI1133_MEAS_BASE_NS << (hw_gain + sw_gain)) * decim_halves / 2;
+  }
+  return (uint32_t)(total_ns * (100 + SI1133_CONVERT_MARGIN_PCT) / 100 / 1000) + SI1133_CONVERT_OVERHEAD_US;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Charge one forced sample costs, for comparing sample rates.
+ *
+ * @details
+ * The conversion at SI1133_ACTIVE_NA for si1133_conversion_us(), the FORCE write and the HOSTOUT
+ * read, and with gating the share of si1133_power_model() that pays for powering the sensor up.
+ *
+ * @param[in] period_ms
+ *  Sample period in milliseconds, for the gating share
+ *
+ * @return
+ *  Charge per sample, nA ms
+ ******************************************************************************/
+uint64_t si1133_sample_charge(uint32_t period_ms) {
+  uint32_t on_na, gated_na;
+  uint64_t charge = (uint64_t)SI1133_ACTIVE_NA * si1133_conversion_us() / 1000 + 2 * SI1133_TRANSACTION_NAMS;
+
+  if (si1133_gated) {
+      si1133_power_model(period_ms, &on_na, &gated_na);
+      charge += (uint64_t)gated_na * period_ms;
+  }
+  return charge;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts a FORCE measurement and reads its results as soon as the conversion is done.
+ *
+ * @details
+ * The FORCE write is queued on the bus and TIMER0 times si1133_conversion_us() from now, so the
+ * HOSTOUT read follows the sensor and not the LETIMER period. The result is timestamped with the
+ * end of the conversion, and the time from there to the callback is the read alone. A sensor left
+ * unpowered by gating is powered up and configured first, as for si1133_gated_sample(), and then
+ * stays on; while gating is chosen use si1133_gated_sample().
+ *
+ * @param[in] cb
+ *  Scheduled event posted with the result, read as for request_res()
+ ******************************************************************************/
+void si1133_measure(uint32_t cb) {
+  EFM_ASSERT(!si1133_gated && si1133_sample_idle());
+  si1133_sample_cb = cb;
+  if (!si1133_powered) { //gating was just given up
+      GPIO_PinOutSet(SI1133_SENSOR_EN_PORT, SI1133_SENSOR_EN_PIN);
+      si1133_gate_replay();
+      return;
+  }
+  if (!force_send()) { //nothing to convert, hand the failure to the caller
+      i2c_event_post(si1133_sample_cb, I2C_STATUS_REFUSED);
+      return;
+  }
+  si1133_convert_wait();
 }
 
+/***************************************************************************//**
+ * @brief
+ * Waits out the conversion of the FORCE just sent, then lets si1133_sample_step() read HOSTOUT.
+ ******************************************************************************/
+void si1133_convert_wait(void) {
+  uint32_t conversion_ms = (si1133_conversion_us() + 999) / 1000;
+
+  si1133_sample_state = SI1133_SAMPLE_CONVERT;
+  si1133_sample_time = letimer_time_get() + conversion_ms;
+  timer_event(conversion_ms, si1133_sample_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Moves a forced measurement on: reads HOSTOUT once the conversion is over, then hands the result on.
+ *
+ * @details
+ * Runs from the sample event given to si1133_i2c_open(), apart from the initialization and its
+ * step event. After the read the sensor is switched off again when gated, and the callback of
+ * si1133_measure() or si1133_gated_sample() is posted with the status of the read, failed or not;
+ * the caller checks si1133_transfer_ok().
+ ******************************************************************************/
+void si1133_sample_step(void) {
+  switch (si1133_sample_state) {
+    case SI1133_SAMPLE_CONVERT:
+      si1133_sample_state = SI1133_SAMPLE_READ;
+      si1133_hostout_read(si1133_sample_evt);
+      si1133_read_time = si1133_sample_time; //the sample is as old as its conversion, not the read
+      break;
+    case SI1133_SAMPLE_READ:
+      if (si1133_gated) {
+          GPIO_PinOutClear(SI1133_SENSOR_EN_PORT, SI1133_SENSOR_EN_PIN);
+          si1133_powered = false;
+      }
+      si1133_sample_state = SI1133_SAMPLE_IDLE;
+      i2c_event_post(si1133_sample_cb, i2c_status_get(si1133_sample_evt));
+      break;
+    default:
+      break;
+  }
+}
@@ -4,6 +4,8 @@
 #include "em_i2c.h"
 #include "i2c.h"
 #include "HW_delay.h"
+#include "rtcc.h"
+#include "gpio.h"
 
 #define POWER_UP_DELAY 25
 #define RESPONSE0 0x11
@@ -20,6 +22,140 @@
 #define HOSTOUT0 0x13
 #define HOSTOUT1 0x14
 #define NUM_READ_TWO 2
+#define SI1133_HOSTOUT_BYTES 26 //HOSTOUT0 to HOSTOUT25
+
+//Autonomous mode
+#define IRQ_ENABLE 0x0F
+#define IRQ_STATUS 0x12 //read just before HOSTOUT0, reading it releases the INT pin
+#define START_CMD 0x13
+#define PAUSE_CMD 0x12
+#define MEAS_RATE_H 0x1A
+#define MEAS_RATE_L 0x1B
+#define MEAS_COUNT0 0x1C
+#define MEASCONFIG0 0x05
+#define MEASCONFIG_COUNTER0 0x40 //COUNTER_INDEX: channel measured every MEAS_RATE * MEAS_COUNT0
+#define SI1133_MEAS_RATE_UNIT_US 800 //MEAS_RATE counts 800 us steps
+#define SI1133_MEAS_RATE_MAX 0xFFFF
+#define IRQ_CHANNEL0 0x01
+
+//Threshold interrupts, the channel interrupt only fires when its result crosses the selected threshold
+#define ADCPOST0 0x04
+#define THRESHOLD0_H 0x25
+#define THRESHOLD0_L 0x26
+#define THRESHOLD1_H 0x27
+#define THRESHOLD1_L 0x28
+#define ADCPOST_THRESH_SEL_0 0x01 //compare against THRESHOLD0
+#define ADCPOST_THRESH_SEL_1 0x02 //compare against THRESHOLD1
+#define ADCPOST_THRESH_POL_BELOW 0x04 //interrupt when the result is below the threshold instead of above
+#define _ADCPOST_THRESH_MASK 0x07
+
+//Channel configuration, each channel has four consecutive parameters starting at ADCCONFIG0
+#define SI1133_MAX_CHANNELS 6
+#define SI1133_CHANNEL_PARAMS 4
+#define ADCPOST_24BIT 0x40 //result is 3 bytes instead of 2
+#define SI1133_LUX_UV_CHANNELS 5 //white for dark/light, then UV, visible high range, IR and visible low range
+
+//Asynchronous initialization
+#define RESET_CMD_CTR 0x00
+#define RESPONSE0_CMD_ERR 0x10 //set with an error code in the counter bits, cleared by RESET_CMD_CTR
+#define SI1133_INIT_POLLS 4 //RESPONSE0 reads waiting for the counter before the step counts as failed
+#define SI1133_INIT_ATTEMPTS 3 //tries of one table entry, each after RESET_CMD_CTR
+
+//Power gating through SI1133_SENSOR_EN in forced mode. Current model in nA, charges in nA * ms; the values are
+//estimates for the Thunderboard Sense 2 and should be tuned against a measurement of the board
+#define SI1133_STANDBY_NA 500 //sensor powered and idle between samples
+#define SI1133_BOOT_NA 250000 //sensor during POWER_UP_DELAY
+#define SI1133_TRANSACTION_NAMS 130 //one short I2C transaction at 400 kHz with the MCU in EM1
+#define SI1133_ACTIVE_NA 4250000 //sensor while measuring, datasheet typical
+#define SI1133_REPLAY_ENTRIES (SI1133_CHANNEL_PARAMS * SI1133_MAX_CHANNELS + 2) //channels, CHAN_LIST and FORCE
+
+//Oversampling fields: ADCCONFIGx DECIM_RATE sets the samples per conversion, ADCSENSx SW_GAIN accumulates 2^n conversions
+#define _ADCCONFIG_DECIM_SHIFT 5
+#define _ADCCONFIG_DECIM_MASK 0x60
+#define SI1133_DECIM_MAX 3
+#define _ADCSENS_SW_GAIN_SHIFT 4
+#define _ADCSENS_SW_GAIN_MASK 0x70
+#define SI1133_SW_GAIN_MAX 7
+#define _ADCSENS_HW_GAIN_MASK 0x0F
+
+//Conversion time: one measurement takes 24.4 us * 2^HW_GAIN at DECIM_RATE 0 (1024 ADC clocks), DECIM_RATE 1, 2 and 3
+//scale it by 2, 4 and 1/2, SW_GAIN repeats it 2^SW_GAIN times and the channels of CHAN_LIST run one after the other
+#define SI1133_MEAS_BASE_NS 24400
+#define SI1133_CONVERT_MARGIN_PCT 10 //ADC clock tolerance on top of the nominal time
+#define SI1133_CONVERT_OVERHEAD_US 200 //command decoding and HOSTOUT update per FORCE
+
+//Lux and UV index polynomial from the Si1133 datasheet and the Silicon Labs board support driver
+#define SI1133_ADC_THRESHOLD 16000 //above this the high range visible channel is used
+#define SI1133_LUX_FRACTION 12 //lux and UV index are returned in Q12
+#define SI1133_UV_FRACTION 12
+#define SI1133_UV_INPUT_FRACTION 15
+#define SI1133_INPUT_FRACTION_HIGH 7
+#define SI1133_INPUT_FRACTION_LOW 15
+#define SI1133_NUMCOEFF_HIGH 4
+#define SI1133_NUMCOEFF_LOW 9
+#define SI1133_UV_NUMCOEFF 2
+
+typedef struct { //the four parameters of one measurement channel
+  uint8_t adcconfig; //DECIM_RATE and ADCMUX, the photodiode measured
+  uint8_t adcsens; //HSIG, SW_GAIN and HW_GAIN
+  uint8_t adcpost; //24BIT_OUT, POSTSHIFT and the threshold selection
+  uint8_t measconfig; //COUNTER_INDEX for autonomous mode
+} SI1133_CHANNEL_CONFIG;
+
+typedef struct { //one term of the lux or UV polynomial, encoded as in the datasheet
+  int16_t info; //high byte: shift, low byte: sign, x order and y order
+  uint16_t mag;
+} SI1133_COEFF;
+
+typedef struct { //results of every configured channel from one HOSTOUT read
+  uint32_t timestamp; //letimer_time_get() when the read was started
+  uint32_t channels;
+  int32_t value[SI1133_MAX_CHANNELS]; //16 bit results as read, 24 bit results sign extended
+} SI1133_RESULT;
+
+typedef enum {
+  SI1133_INIT_PARAM, //PARAM_SET of a parameter table entry, verified through RESPONSE0
+  SI1133_INIT_REG, //plain register write
+  SI1133_INIT_CMD //command, verified through RESPONSE0
+} SI1133_INIT_OP;
+
+typedef struct { //one step of an initialization table
+  uint8_t op;
+  uint8_t addr; //parameter, register or command code
+  uint8_t value;
+} SI1133_INIT_ENTRY;
+
+typedef enum {
+  SI1133_SAMPLE_IDLE, //no measurement in progress; the sensor is unpowered when gating
+  SI1133_SAMPLE_CONFIG, //sensor powering up, then cached configuration and FORCE being replayed
+  SI1133_SAMPLE_CONVERT, //waiting for the conversion
+  SI1133_SAMPLE_READ //HOSTOUT read in flight, the sensor is switched off after it
+} SI1133_SAMPLE_STATE;
+
+typedef enum {
+  SI1133_INIT_IDLE,
+  SI1133_INIT_POWERUP, //waiting POWER_UP_DELAY after SI1133_SENSOR_EN was set
+  SI1133_INIT_WRITE, //entry or RESET_CMD_CTR written, waiting for the bus
+  SI1133_INIT_VERIFY, //RESPONSE0 read, waiting for the bus
+  SI1133_INIT_DONE,
+  SI1133_INIT_FAILED
+} SI1133_INIT_STATE;
+
+#define SI1133_PARAM(param, value)  { SI1133_INIT_PARAM, (param), (value) }
+#define SI1133_REG(reg, value)      { SI1133_INIT_REG, (reg), (value) }
+#define SI1133_CMD(cmd)             { SI1133_INIT_CMD, (cmd), 0 }
+#define SI1133_CHANNEL(ch, adcconfig, adcsens, adcpost, measconfig) \
+  SI1133_PARAM(ADCCONFIG0 + SI1133_CHANNEL_PARAMS * (ch), (adcconfig)), \
+  SI1133_PARAM(ADCCONFIG0 + SI1133_CHANNEL_PARAMS * (ch) + 1, (adcsens)), \
+  SI1133_PARAM(ADCCONFIG0 + SI1133_CHANNEL_PARAMS * (ch) + 2, (adcpost)), \
+  SI1133_PARAM(ADCCONFIG0 + SI1133_CHANNEL_PARAMS * (ch) + 3, (measconfig))
+
+//Channels 1 to 4 as set up by the Silicon Labs board support driver for lux and UV index, behind a white channel 0
+#define SI1133_LUX_UV_INIT \
+  SI1133_CHANNEL(1, 0x78, 0x71, ADCPOST_24BIT, MEASCONFIG_COUNTER0), /*UV*/ \
+  SI1133_CHANNEL(2, 0x4d, 0xe1, ADCPOST_24BIT, MEASCONFIG_COUNTER0), /*large white, high signal range*/ \
+  SI1133_CHANNEL(3, 0x41, 0xe1, 0x50, MEASCONFIG_COUNTER0),          /*medium IR, post shift 2*/ \
+  SI1133_CHANNEL(4, 0x4d, 0x87, ADCPOST_24BIT, MEASCONFIG_COUNTER0)  /*large white, normal range*/
 #define I2C_CB 0x00000008
 #define MASK_BIT 0x0F
 
@@ -27,12 +163,38 @@
 
 
 
-void si1133_i2c_open();
-void Si1133_read(uint32_t reg_addy,uint32_t number_bytes, uint32_t cb);
-void Si1133_write(uint32_t reg_addy, uint32_t number_bytes, uint32_t cb);
+void si1133_i2c_open(uint32_t service_evt, uint32_t sample_evt);
+bool Si1133_read(uint32_t reg_addy,uint32_t number_bytes, uint32_t cb);
+bool Si1133_write(uint32_t reg_addy, uint32_t number_bytes, uint32_t cb);
 uint32_t send_si1133_data();
-void force_send();
+bool force_send();
 void request_res();
+bool si1133_burst_read(uint32_t reg_addy, uint8_t *buf, uint32_t number_bytes, uint32_t cb);
+bool si1133_transfer_ok(uint32_t cb);
+bool si1133_irq_read(uint32_t cb);
+bool si1133_int_pending(void);
+void si1133_threshold_arm(bool dark);
+void si1133_threshold_disarm(void);
+int32_t si1133_channel_get(uint32_t channel);
+void si1133_result_get(SI1133_RESULT *result);
+void si1133_oversampling_set(uint32_t channel, uint32_t decim_rate, uint32_t sw_gain);
+void si1133_init_start(const SI1133_INIT_ENTRY *table, uint32_t count, uint32_t step_evt, uint32_t ready_evt);
+void si1133_init_step(void);
+bool si1133_ready(void);
+uint32_t si1133_cmd_errors_get(void);
+void si1133_int_open(uint32_t int_evt);
+void si1133_trigger_open(uint32_t prs_ch, uint32_t int_evt);
+void si1133_power_model(uint32_t period_ms, uint32_t *on_na, uint32_t *gated_na);
+bool si1133_power_policy(uint32_t period_ms);
+bool si1133_power_gated(void);
+bool si1133_sample_idle(void);
+void si1133_gated_sample(uint32_t cb);
+uint32_t si1133_conversion_us(void);
+uint64_t si1133_sample_charge(uint32_t period_ms);
+void si1133_measure(uint32_t cb);
+void si1133_sample_step(void);
+int32_t si1133_lux_get(int32_t vis_high, int32_t vis_low, int32_t ir);
+int32_t si1133_uvi_get(int32_t uv);
 
 
 #endif /* HEADER_FILES_SI1133_H_ */
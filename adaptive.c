@@ -0,0 +1,118 @@
+/**
+ * @file adaptive.c
+ * @author agent
+ * @date 10/18/2026
+ * @brief Sample period controller that follows the variability of the signal
+ *
+ */
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "adaptive.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *  Sets up a period controller and clears its counters.
+ *
+ * @param[in] rate
+ *  Controller to set up
+ *
+ * @param[in] min_period
+ *  Shortest period, used while the signal changes, ticks
+ *
+ * @param[in] max_period
+ *  Longest period a stable signal backs off to, ticks
+ *
+ * @param[in] period
+ *  Period in use now, clamped to the bounds
+ *
+ * @param[in] change
+ *  Difference between two consecutive samples above which the signal counts as changing
+ *
+ * @param[in] stable_samples
+ *  Stable samples in a row before each stretch of the period, at least 1
+ *
+ * @param[in] holdoff
+ *  Samples at least between two period changes, the rate limit; 1 allows a change on every sample
+ ******************************************************************************/
+void adaptive_open(ADAPTIVE *rate, uint32_t min_period, uint32_t max_period, uint32_t period, uint32_t change, uint32_t stable_samples, uint32_t holdoff) {
+  EFM_ASSERT(min_period > 0 && min_period <= max_period);
+  EFM_ASSERT(stable_samples > 0 && holdoff > 0);
+  rate->min_period = min_period;
+  rate->max_period = max_period;
+  rate->period = period < min_period ? min_period : (period > max_period ? max_period : period);
+  rate->change = change;
+  rate->stable_samples = stable_samples;
+  rate->holdoff = holdoff;
+  rate->has_last = false;
+  rate->stable = 0;
+  rate->since_change = holdoff;
+  rate->samples = 0;
+  rate->changes = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Feeds a sample to the controller and returns the period to use from now on.
+ *
+ * @details
+ *  A sample that differs from the previous one by more than change halves the period, down to
+ *  min_period, so a moving signal is followed quickly. Every stable_samples stable samples in a row
+ *  stretch it by 1/ADAPTIVE_BACKOFF_DIV, up to max_period, so a steady signal backs off gradually.
+ *  Either way the period changes at most once every holdoff samples.
+ *
+ * @param[in] rate
+ *  Controller set up with adaptive_open()
+ *
+ * @param[in] sample
+ *  New sample
+ *
+ * @return
+ *  Period for the next samples, ticks; unchanged most of the time
+ ******************************************************************************/
+uint32_t adaptive_update(ADAPTIVE *rate, uint32_t sample) {
+  uint32_t delta = (sample > rate->last) ? sample - rate->last : rate->last - sample;
+  uint32_t period = rate->period;
+
+  rate->samples++;
+  if (rate->since_change < rate->holdoff) rate->since_change++;
+  if (rate->has_last && delta > rate->change) {
+      rate->stable = 0;
+      period = period / 2;
+      if (period < rate->min_period) period = rate->min_period;
+  }
+  else if (++rate->stable >= rate->stable_samples) {
+      uint32_t step = period / ADAPTIVE_BACKOFF_DIV;
+      period += step ? step : 1;
+      if (period > rate->max_period) period = rate->max_period;
+  }
+  rate->last = sample;
+  rate->has_last = true;
+
+  if (period != rate->period && rate->since_change >= rate->holdoff) {
+      rate->period = period;
+      rate->stable = 0;
+      rate->since_change = 0;
+      rate->changes++;
+  }
+  return rate->period;
+}
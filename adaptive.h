@@ -0,0 +1,50 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef ADAPTIVE_HG
+#define ADAPTIVE_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define ADAPTIVE_BACKOFF_DIV    4   // a stable signal stretches the period by a quarter per step
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+typedef struct {
+  uint32_t min_period; //bounds of the period, ticks
+  uint32_t max_period;
+  uint32_t period; //current period
+  uint32_t change; //difference between two samples above which the signal is changing
+  uint32_t stable_samples; //stable samples in a row before the period is stretched
+  uint32_t holdoff; //samples at least between two period changes
+  uint32_t last;
+  bool has_last;
+  uint32_t stable;
+  uint32_t since_change;
+  uint32_t samples; //samples since adaptive_open()
+  uint32_t changes; //period changes since adaptive_open()
+} ADAPTIVE;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void adaptive_open(ADAPTIVE *rate, uint32_t min_period, uint32_t max_period, uint32_t period, uint32_t change, uint32_t stable_samples, uint32_t holdoff);
+uint32_t adaptive_update(ADAPTIVE *rate, uint32_t sample);
+
+#endif
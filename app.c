@@ -23,13 +23,82 @@
 //***********************************************************************************
 static uint32_t x = 3;
 static uint32_t y = 0;
+static uint8_t trace_log[2*TRACE_LOG_SAMPLES];
+static uint32_t trace_count = 0;
+static uint32_t em1_ticks_base = 0; //EM1 ticks and time when the I2C statistics were last restarted
+static uint32_t i2c_time_base = 0;
+static HYSTERESIS light_hyst; //dark/light decision on the filtered readings, high when light
+static ADAPTIVE light_rate; //LETIMER0 period following how fast the filtered readings change
+static uint32_t rate_time_base = 0; //letimer_time_get() when light_rate was last opened
+static uint32_t burst_samples = 0; //samples of the burst in progress
+static uint32_t burst_time_base = 0; //letimer_time_get() when it started
+static SI1133_RESULT lux_result; //last results of the lux and UV index channels
+static FILTER light_filter; //between the channel 0 readings and the dark/light decision
+static STATS_WINDOW light_stats; //per minute summaries of the channel 0 readings
+static bool stats_summaries = true; //summaries are sent instead of the per sample messages, dark/light edges still are
 #define BLE_TEST_ENABLED
+#define SI1133_AUTONOMOUS_ENABLED   //the sensor times its own measurements and interrupts on each result
+//#define SI1133_TRIGGER_ENABLED    //without autonomous mode, the COMP1 edge of LETIMER0 writes FORCE through the PRS and the LDMA; the MCU stays in EM1
+#define SI1133_LUX_UV_ENABLED       //measures the UV, visible and IR channels as well and reports lux and UV index
+#ifdef SI1133_LUX_UV_ENABLED
+#define APP_SI1133_CHANNELS         SI1133_LUX_UV_CHANNELS
+#else
+#define APP_SI1133_CHANNELS         1
+#endif
+#if defined(SI1133_TRIGGER_ENABLED) && defined(SI1133_AUTONOMOUS_ENABLED)
+#error "SI1133_TRIGGER_ENABLED starts forced measurements, it cannot be combined with SI1133_AUTONOMOUS_ENABLED"
+#endif
+#define APP_SI1133_PRS_CH           0   //PRS channel, and LDMA SYNC bit, from LETIMER0 OUT1 to the FORCE write
+#define APP_SI1133_MEAS_RATE        (PWM_PER_MS * 1000 / SI1133_MEAS_RATE_UNIT_US)
+_Static_assert(LETIMER_PWM_VALID(PWM_PER_TICKS, PWM_ACT_PER_TICKS), "PWM_PER_MS/PWM_ACT_PER_MS do not fit the LETIMER compare registers");
+_Static_assert(PWM_PER_TICKS * 1000 / LETIMER_HZ == PWM_PER_MS, "PWM_PER_MS is not a whole number of LETIMER ticks");
+_Static_assert(RATE_MAX_MS <= LETIMER_MAX_PERIOD_MS && PWM_PER_MS <= LETIMER_MAX_PERIOD_MS, "raise LETIMER_MAX_PERIOD_MS");
+static bool threshold_mode = false; //#T1! in autonomous mode, the sensor only interrupts when the light crosses dark/light; the app filters see crossings only
+#ifdef SI1133_AUTONOMOUS_ENABLED
+static bool adaptive_rate = false; //the sensor times its own measurements, the LETIMER0 period does not set the sample rate
+#else
+static bool adaptive_rate = true;
+#endif
+
+//Si1133 configuration, written by si1133_init_start() while the rest of the system boots
+static const SI1133_INIT_ENTRY app_si1133_init[] = {
+    SI1133_CHANNEL(0, WHITE_COLOR, 0x00, 0x00, MEASCONFIG_COUNTER0),
+#ifdef SI1133_LUX_UV_ENABLED
+    SI1133_LUX_UV_INIT,
+#endif
+    SI1133_PARAM(CHAN_LIST, (1 << APP_SI1133_CHANNELS) - 1),
+#ifdef SI1133_AUTONOMOUS_ENABLED
+    SI1133_PARAM(THRESHOLD0_H, READ_RES_TWENTY >> 8), //only compared once #T1! selects them in ADCPOST0
+    SI1133_PARAM(THRESHOLD0_L, READ_RES_TWENTY & 0xFF),
+    SI1133_PARAM(THRESHOLD1_H, (READ_RES_TWENTY + LIGHT_HYSTERESIS) >> 8),
+    SI1133_PARAM(THRESHOLD1_L, (READ_RES_TWENTY + LIGHT_HYSTERESIS) & 0xFF),
+    SI1133_PARAM(MEAS_RATE_H, APP_SI1133_MEAS_RATE >> 8),
+    SI1133_PARAM(MEAS_RATE_L, APP_SI1133_MEAS_RATE & 0xFF),
+    SI1133_PARAM(MEAS_COUNT0, 1),
+    SI1133_REG(IRQ_ENABLE, IRQ_CHANNEL0),
+    SI1133_CMD(START_CMD),
+#elif defined(SI1133_TRIGGER_ENABLED)
+    SI1133_REG(IRQ_ENABLE, 1 << (APP_SI1133_CHANNELS - 1)), //the last channel of a FORCE is done last
+#endif
+};
 
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
 
-static void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, uint32_t out1_route);
+static void app_letimer_pwm_open(uint32_t period, uint32_t act_period, uint32_t out0_route, uint32_t out1_route);
+static void app_link_stats_report(void);
+static void app_i2c_stats_report(void);
+static void app_lux_report(void);
+static void app_lux_benchmark(void);
+static void app_filter_benchmark(void);
+static void app_stats_report(void);
+static void app_hysteresis_report(void);
+static void app_rate_open(uint32_t min_ms, uint32_t max_ms);
+static void app_rate_report(void);
+static void app_period_report(void);
+static void app_clock_report(void);
+static void app_power_policy(void);
 
 //***********************************************************************************
 // Global functions
@@ -50,14 +119,21 @@ static void app_letimer_pwm_open(float period, float act_period, uint32_t out0_r
 void app_peripheral_setup(void){
   scheduler_open();
   sleep_open();
+  benchmark_open();
+  filter_open(&light_filter, LIGHT_FILTER_TYPE, LIGHT_FILTER_TAPS, LIGHT_FILTER_SHIFT);
+  stats_open(&light_stats, STATS_WINDOW_SAMPLES, STATS_WINDOW_SAMPLES);
+  hysteresis_open(&light_hyst, READ_RES_TWENTY, READ_RES_TWENTY + LIGHT_HYSTERESIS, LIGHT_DWELL_MS, true, true);
 
   cmu_open();
   gpio_open();
-  si1133_i2c_open();
   rgb_init();
-  app_letimer_pwm_open(PWM_PER, PWM_ACT_PER, PWM_ROUTE_0, PWM_ROUTE_1);
-  ble_open(TX_CB, RX_CB);
+  rgb_pwm_open();
+  app_letimer_pwm_open(PWM_PER_TICKS, PWM_ACT_PER_TICKS, PWM_ROUTE_0, PWM_ROUTE_1);
+  app_rate_open(RATE_MIN_MS, RATE_MAX_MS); //starts from the PWM_PER_TICKS just programmed
   letimer_start(LETIMER0, true);  //This command will initiate the start of the LETIMER0
+  si1133_i2c_open(I2C_SERVICE_CB, SI1133_SAMPLE_CB);
+  si1133_init_start(app_si1133_init, sizeof(app_si1133_init) / sizeof(app_si1133_init[0]), SI1133_STEP_CB, SI1133_READY_CB);
+  ble_open(TX_CB, RX_CB);
   add_scheduled_event(BOOT_UP_CB);
   sleep_block_mode(SYSTEM_BLOCK_EM);
 }
@@ -76,14 +152,17 @@ void app_peripheral_setup(void){
  *  requirements for the driver function.
  *
  * @param[in] period
- *  The total period of our PWM cycle defined in the app.h file.
+ *  The total period of our PWM cycle defined in the app.h file, in LETIMER ticks.
+ *
+ * @param[in] act_period
+ *  The active period, in LETIMER ticks.
  *
  * @param[in] out_pin_route0
  * The location that will be used to route the LETIMER0 outputs to the output pins of the Gecko green LED.
  *
  ******************************************************************************/
 
-void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, uint32_t out1_route){
+void app_letimer_pwm_open(uint32_t period, uint32_t act_period, uint32_t out0_route, uint32_t out1_route){
   // Initializing LETIMER0 for PWM operation by creating the
   // letimer_pwm_struct and initializing all of its elements
   // APP_LETIMER_PWM_TypeDef is defined in letimer.h
@@ -94,8 +173,8 @@ void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, u
   letimer_pwm_struct.enable = false; //15) f) don't want to enable or turn-on the LETIMER until the peripheral is completely programmed
   letimer_pwm_struct.out_pin_0_en = false;
   letimer_pwm_struct.out_pin_1_en = false;
-  letimer_pwm_struct.period = period; //seconds 3.000 seconds from the defined files
-  letimer_pwm_struct.active_period = act_period; //seconds 0.250 seconds from the defined files
+  letimer_pwm_struct.period = period; //ticks, PWM_PER_TICKS from the defined files
+  letimer_pwm_struct.active_period = act_period; //ticks, PWM_ACT_PER_TICKS from the defined files
   letimer_pwm_struct.out_pin_route0 = out0_route;
   letimer_pwm_struct.out_pin_route1 = out1_route;
 
@@ -122,7 +201,8 @@ void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, u
  *
  * @details
  * In this underflow function, the request res() will be called which will then call
- * the Si1133 read function to read the sensor values. The function has three variables,
+ * the Si1133 read function to read the sensor values. In autonomous mode the sensor interrupts
+ * on its own and the underflow only recovers an INT pin left low. The function has three variables,
  * x, y and z which keeps changing and the z value is sent out to the ble_write function
  * as a string.
  *
@@ -132,15 +212,32 @@ void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, u
  ******************************************************************************/
 void scheduled_letimer0_uf_cb(void){
   EFM_ASSERT(!(get_scheduled_events() & LETIMER0_UF_CB));
-  request_res();
-  float z;
-  x = x + 3;
-  y = y + 1;
-  z = (float)x / (float)y;
-  char string_app[50];
-  sprintf(string_app, "Z = %2.1f\n", z);
-
-  ble_write(string_app);
+#ifdef SI1133_TRIGGER_ENABLED
+  ble_power_period(); //COMP1 goes to the PRS, its callback no longer runs
+#endif
+  if (si1133_power_gated()) {
+      if (si1133_sample_idle()) si1133_gated_sample(SI1133_LIGHT_CB); //powers the sensor up for this sample only
+  }
+  else if (si1133_ready()) {
+#if defined(SI1133_AUTONOMOUS_ENABLED) || defined(SI1133_TRIGGER_ENABLED)
+      if (si1133_int_pending() && !i2c_busy(I2C1) && !(get_scheduled_events() & SI1133_INT_CB)) {
+          si1133_irq_read(SI1133_LIGHT_CB); //the edge was missed, or the read that should release the pin failed
+      }
+#endif
+  }
+  ble_service();
+  rgb_service();
+  if (!letimer_burst_active() && !stats_summaries) { //a burst would flood the link, summaries replace it
+      float z;
+      x = x + 3;
+      y = y + 1;
+      z = (float)x / (float)y;
+      char string_app[50];
+      sprintf(string_app, "Z = %2.1f\n", z);
+
+      ble_write(string_app);
+  }
+  ble_power_idle();
 }
 
 /***************************************************************************//**
@@ -173,7 +270,13 @@ void scheduled_letimer0_comp0_cb(void) {
  ******************************************************************************/
 
 void scheduled_letimer0_comp1_cb(void) {
-  force_send();
+#ifndef SI1133_AUTONOMOUS_ENABLED
+  if (si1133_ready() && !si1133_power_gated() && si1133_sample_idle()) {
+      si1133_measure(SI1133_LIGHT_CB); //read as soon as the conversion is done
+  }
+#endif
+  ble_power_period();
+  ble_service();
 }
 
 
@@ -191,27 +294,65 @@ void scheduled_letimer0_comp1_cb(void) {
  *  On hardware, the way to implement this is by putting your finger over the sensor, which will cause the
  *  sensor value to go down and the LED to turn on and under sunlight/bright light, the sensor value goes
  *  up turning the LED off.
+ *  The decision is made by light_hyst: dark below READ_RES_TWENTY, light again only above
+ *  READ_RES_TWENTY + LIGHT_HYSTERESIS, and only once the reading stayed past the threshold for the dwell
+ *  time. In report on change mode, the default, the LED and the message change only on an edge.
+ *  With threshold interrupts a read follows a crossing and the threshold for the way back is armed.
+ *  Otherwise every reading goes through light_filter first, and the decision is made on the filtered value.
+ *  With forced measurements the filtered value also drives light_rate, which sets the LETIMER0 period.
+ *  Every reading also feeds light_stats; while summaries are on, they replace the per sample messages,
+ *  one BLE message per window instead of two or three per sample. Dark/light edges are still sent
+ *  as they happen, and the Z line of the underflow callback is dropped.
  *
  ******************************************************************************/
 void scheduled_si1133_read_cb(void) {
  // EFM_ASSERT(!(get_scheduled_events() & SI1133_LIGHT_CB));
+  if (!si1133_transfer_ok(SI1133_LIGHT_CB)) {
+      ble_write("Si1133 read failed\n");
+      return;
+  }
   uint32_t si1133_read_check = send_si1133_data();
 
-  if (si1133_read_check < READ_RES_TWENTY) {
+  if (!ble_arq_busy() && trace_count < TRACE_LOG_SAMPLES) {
+      trace_log[2*trace_count] = (si1133_read_check >> 8) & 0xFF;
+      trace_log[2*trace_count + 1] = si1133_read_check & 0xFF;
+      trace_count++;
+  }
+  if (stats_update(&light_stats, si1133_read_check) && stats_summaries) app_stats_report();
+#ifdef SI1133_LUX_UV_ENABLED
+  if (!stats_summaries) app_lux_report();
+#endif
+
+  uint32_t light = si1133_read_check;
+
+  if (!threshold_mode) light = filter_update(&light_filter, si1133_read_check); //a single noisy sample no longer flips the LED
+  if (adaptive_rate && !letimer_burst_active()) {
+      uint32_t period = adaptive_update(&light_rate, light);
+      if (period != letimer_period_get(LETIMER0)) {
+          letimer_period_set(LETIMER0, period);
+          app_power_policy();
+      }
+  }
+  HYSTERESIS_RESULT result = hysteresis_update(&light_hyst, light, letimer_time_get());
+  if (threshold_mode) si1133_threshold_arm(!light_hyst.high);
+  if (result == HYSTERESIS_SUPPRESS) return;
+  bool report = !stats_summaries || result == HYSTERESIS_CHANGED; //an edge is news, summaries or not
+
+  if (!light_hyst.high) {
 
       leds_enabled(RGB_LED_1, COLOR_BLUE, true);
       char string_read_val[50];
-      float read = (float) si1133_read_check;
+      float read = (float) light;
       sprintf(string_read_val, "It's dark = %3.0f\n", read);
-      ble_write(string_read_val);
+      if (report) ble_write(string_read_val);
   }
-  else if (si1133_read_check >= READ_RES_TWENTY) {
+  else {
 
       leds_enabled(RGB_LED_1, COLOR_BLUE, false);
       char string_read_val_2[50];
-      float read2 = (float) si1133_read_check;
+      float read2 = (float) light;
       sprintf(string_read_val_2, "It's light outside = %3.0f\n", read2);
-      ble_write(string_read_val_2);
+      if (report) ble_write(string_read_val_2);
 
   }
  }
@@ -237,12 +378,237 @@ void scheduled_bootup_cb(void) {
    EFM_ASSERT(res_value);
   timer_delay(TWO_SEC_DELAY); //MAgic
 #endif
+  ble_link_open(BLE_LINK_CB);
   ble_write("\nHelloWorld\n");
   letimer_start(LETIMER0, true);
 }
 
+/***************************************************************************//**
+ * @brief
+ *  Application code after the Si1133 has pulled its INT pin low in autonomous mode.
+ *
+ * @details
+ *  The measurement is complete, so it is read at once; scheduled_si1133_read_cb() handles the
+ *  result exactly as it does for a FORCE measurement.
+ ******************************************************************************/
+void scheduled_si1133_int_cb(void) {
+  si1133_irq_read(SI1133_LIGHT_CB);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Moves the Si1133 initialization on after each of its I2C transactions.
+ ******************************************************************************/
+void scheduled_si1133_step_cb(void) {
+  si1133_init_step();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Moves a forced Si1133 measurement on, from the end of its conversion to its result.
+ ******************************************************************************/
+void scheduled_si1133_sample_cb(void) {
+  si1133_sample_step();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Application code once the Si1133 initialization table has been written, or has failed.
+ *
+ * @details
+ *  In autonomous mode the INT pin is only routed now, the START command being the last entry of
+ *  the table. With SI1133_TRIGGER_ENABLED the COMP1 edge of LETIMER0 is handed to the FORCE write
+ *  of the I2C1 trigger loop, and the CPU only wakes on the INT pin to read the result. Otherwise the supply of the sensor is gated between samples if the current model of
+ *  the driver finds that cheaper for the sample period. Until then the LETIMER callbacks leave the
+ *  sensor alone. Gated samples replay the configuration themselves and only post this event when
+ *  that fails.
+ ******************************************************************************/
+void scheduled_si1133_ready_cb(void) {
+  char string_ready[50];
+
+  if (!si1133_ready()) {
+      sprintf(string_ready, "Si1133 init failed cmd err %lu\n", (unsigned long)si1133_cmd_errors_get());
+      ble_write(string_ready);
+      return;
+  }
+#ifdef SI1133_AUTONOMOUS_ENABLED
+  si1133_int_open(SI1133_INT_CB);
+#elif defined(SI1133_TRIGGER_ENABLED)
+  si1133_trigger_open(APP_SI1133_PRS_CH, SI1133_INT_CB); //not gated, the sensor has to take the FORCE any time
+  letimer_prs_open(LETIMER0, APP_SI1133_PRS_CH, true);
+  ble_write("Si1133 FORCE on LETIMER0 COMP1\n");
+#else
+  if (!si1133_power_gated()) {
+      uint32_t on_na, gated_na;
+      uint32_t period_ms = letimer_period_get(LETIMER0) * 1000 / LETIMER_HZ;
+      bool gated = si1133_power_policy(period_ms);
+      si1133_power_model(period_ms, &on_na, &gated_na);
+      sprintf(string_ready, "Si1133 %s on %lunA gated %lunA\n", gated ? "gated" : "on",
+              (unsigned long)on_na, (unsigned long)gated_na);
+      ble_write(string_ready);
+      sprintf(string_ready, "Si1133 conversion %lu us\n", (unsigned long)si1133_conversion_us());
+      ble_write(string_ready);
+  }
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Application code after LETIMER0 has counted out a burst started with #Nn,p! and stopped.
+ *
+ * @details
+ *  Puts LETIMER0 back on its normal period and reports the samples and the time the burst took.
+ *  The samples themselves went through scheduled_si1133_read_cb() like any other.
+ ******************************************************************************/
+void scheduled_burst_done_cb(void) {
+  char string_burst[50];
+
+  letimer_burst_restore(LETIMER0);
+  sprintf(string_burst, "N %lu in %lu ms\n", (unsigned long)burst_samples,
+          (unsigned long)((letimer_time_get() - burst_time_base) * 1000 / LETIMER_TIME_HZ));
+  ble_write(string_burst);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Application code when an I2C attempt has timed out, a retry is due or a failed attempt left the bus to reset.
+ *
+ * @details
+ *  The RTCC posts this at the nearest I2C deadline and the I2C interrupt after a bus error, so the
+ *  recovery runs here, in the main loop, and keeps its own time whatever the LETIMER period.
+ ******************************************************************************/
+void scheduled_i2c_service_cb(void) {
+  i2c_service();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Application code after the LEUART has finished transmitting a string.
+ *
+ * @details
+ *  The BLE ARQ sender queues one frame at a time, so every completed transmission is the
+ *  point to hand it the next frame of its window.
+ ******************************************************************************/
 void scheduled_tx_cb(void) {
-  //never ended up writing anything here from lab 6, so probably not required for Lab 7
+  ble_service();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Application code after the BLE module has reported a connection or a disconnection.
+ *
+ * @details
+ *  While no central is connected ble_write() holds telemetry back instead of transmitting
+ *  it, so the CPU does not leave EM2 to feed the LEUART for nobody.
+ ******************************************************************************/
+void scheduled_ble_link_cb(void) {
+  ble_link_update();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Sends the transmission count and energy mode residency for each BLE link state, and the
+ *  BLE module power statistics.
+ *
+ * @details
+ *  One line per state: strings transmitted, time in the state and the ticks spent in EM1
+ *  and EM2, all times in LETIMER ticks. Then the telemetry held back and dropped while
+ *  disconnected, and the HM-10 estimated average current, sleeps, wakes and wake latency.
+ ******************************************************************************/
+void app_link_stats_report(void) {
+  BLE_LINK_STATS stats;
+  BLE_PWR_STATS pwr_stats;
+  char string_stats[50];
+
+  ble_link_stats(&stats);
+  for (uint32_t i = 0; i < BLE_LINK_STATES; i++) {
+      sprintf(string_stats, "L%lu tx%lu t%lu e1 %lu e2 %lu\n", (unsigned long)i,
+              (unsigned long)stats.tx_sent[i], (unsigned long)stats.time[i],
+              (unsigned long)stats.em_ticks[i][EM1], (unsigned long)stats.em_ticks[i][EM2]);
+      ble_write(string_stats);
+  }
+  sprintf(string_stats, "held %lu dropped %lu\n", (unsigned long)stats.tx_buffered,
+          (unsigned long)stats.tx_dropped);
+  ble_write(string_stats);
+
+  ble_power_stats(&pwr_stats);
+  sprintf(string_stats, "BLE %luuA sl%lu wk%lu lat%lu/%lu\n", (unsigned long)pwr_stats.average_ua,
+          (unsigned long)pwr_stats.sleeps, (unsigned long)pwr_stats.wakes,
+          (unsigned long)pwr_stats.wake_latency_last, (unsigned long)pwr_stats.wake_latency_max);
+  ble_write(string_stats);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Sends the interrupts per Si1133 transaction in each I2C mode, and the share of time spent in EM1.
+ *
+ * @details
+ *  Interrupts per transaction are given in hundredths. A Si1133 transaction keeps the CPU out of
+ *  EM2 for its whole duration in both modes, so the EM1 ticks since the last #I0! / #I1! tell how
+ *  much of that time the CPU actually slept instead of running interrupt handlers. Then the failed
+ *  attempts per cause, the reads that failed for good, and the longest completion time seen next to
+ *  the guaranteed worst case.
+ ******************************************************************************/
+void app_i2c_stats_report(void) {
+  I2C_STATS stats[I2C_MODES];
+  uint32_t ticks[MAX_ENERGY_MODES];
+  uint32_t errors[I2C_STATUSES];
+  uint32_t failures;
+  uint32_t latency_max;
+  char string_stats[50];
+
+  i2c_stats_get(I2C1, stats);
+  for (uint32_t i = 0; i < I2C_MODES; i++) {
+      uint32_t per_100 = stats[i].transactions ? 100 * stats[i].interrupts / stats[i].transactions : 0;
+      sprintf(string_stats, "%s %lu tr %lu.%02lu int %lu B\n", (i == I2C_MODE_LDMA) ? "DMA" : "IRQ",
+              (unsigned long)stats[i].transactions, (unsigned long)(per_100 / 100),
+              (unsigned long)(per_100 % 100), (unsigned long)stats[i].bytes);
+      ble_write(string_stats);
+  }
+  sleep_stats_get(NULL, ticks);
+  sprintf(string_stats, "EM1 %lu of %lu t\n", (unsigned long)(ticks[EM1] - em1_ticks_base),
+          (unsigned long)(letimer_time_get() - i2c_time_base));
+  ble_write(string_stats);
+
+  i2c_error_stats_get(I2C1, errors, &failures, &latency_max);
+  sprintf(string_stats, "nk%lu al%lu be%lu to%lu fail %lu\n", (unsigned long)errors[I2C_STATUS_NACK],
+          (unsigned long)errors[I2C_STATUS_ARBLOST], (unsigned long)errors[I2C_STATUS_BUSERR],
+          (unsigned long)errors[I2C_STATUS_TIMEOUT], (unsigned long)failures);
+  ble_write(string_stats);
+  sprintf(string_stats, "lat %lu wc %lu t\n", (unsigned long)latency_max,
+          (unsigned long)i2c_worst_case_ticks(I2C_SERVICE_INTERVAL));
+  ble_write(string_stats);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Application code after the host has acknowledged the whole trace log.
+ *
+ * @details
+ *  Reports the payload throughput of the transfer next to the raw link rate and empties the
+ *  trace log so it can collect new readings.
+ ******************************************************************************/
+void scheduled_arq_done_cb(void) {
+  BLE_ARQ_STATS stats;
+  char string_arq[50];
+
+  ble_arq_stats(&stats);
+  sprintf(string_arq, "ARQ %lu/%u B/s rtx %lu\n", (unsigned long)stats.throughput,
+          BLE_LINK_BYTES_PER_SEC, (unsigned long)stats.retransmits);
+  ble_write(string_arq);
+  trace_count = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Application code when the oldest unacknowledged ARQ frame has timed out.
+ *
+ * @details
+ *  Posted by the RTCC BLE_ARQ_RTO after the frame was sent, so a lost ACK is answered on time
+ *  even when the LETIMER period is much longer than the timeout.
+ ******************************************************************************/
+void scheduled_arq_rto_cb(void) {
+  ble_service();
 }
 
 /***************************************************************************//**
@@ -261,17 +627,188 @@ void scheduled_tx_cb(void) {
  *
  * @note
  *
- * The compare_set(LETIMER_TypeDef * letimer, int increment_decrement) function is called at the end of this
- * function with one of the parameters as the change in speed of the active period. The compare_set function is
- * in letimer.c
+ * The compare_set(LETIMER_TypeDef * letimer, int increment_decrement) function is called with the change in
+ * speed of the period, which takes effect at the next underflow; #U! alone only reports the period. The
+ * compare_set function is in letimer.c
  ******************************************************************************/
 void scheduled_rx_cb(void) {
 
    char s_string[50];
-   uint32_t change_speed = 0;
+   int change_speed = 0;
 
    return_read_val(s_string);
 
+   ble_link_rx_seen();
+   if (ble_arq_rx(s_string)) return;
+
+   if (s_string[1] == LINK_STATS_CMD) {
+       app_link_stats_report();
+       return;
+   }
+
+   if (s_string[1] == I2C_STATS_CMD) {
+       if (s_string[2] == '0' || s_string[2] == '1') {
+           uint32_t ticks[MAX_ENERGY_MODES];
+           i2c_ldma_enable(I2C1, s_string[2] == '1');
+           sleep_stats_get(NULL, ticks);
+           em1_ticks_base = ticks[EM1];
+           i2c_time_base = letimer_time_get();
+       }
+       app_i2c_stats_report();
+       return;
+   }
+
+   if (s_string[1] == OVERSAMPLE_CMD) {
+       uint32_t channel = s_string[2] - 0x30, decim = s_string[3] - 0x30, sw_gain = s_string[4] - 0x30;
+       if (channel < APP_SI1133_CHANNELS && decim <= SI1133_DECIM_MAX && sw_gain <= SI1133_SW_GAIN_MAX) {
+           si1133_oversampling_set(channel, decim, sw_gain);
+       }
+       return;
+   }
+
+   if (s_string[1] == STATS_CMD) {
+       if (s_string[2] == 'T') stats_open(&light_stats, STATS_WINDOW_SAMPLES, STATS_WINDOW_SAMPLES);
+       else if (s_string[2] == 'S') stats_open(&light_stats, STATS_WINDOW_SAMPLES, STATS_SLIDING_HOP);
+       stats_summaries = (s_string[2] == 'T' || s_string[2] == 'S');
+       return;
+   }
+
+   if (s_string[1] == BURST_CMD) {
+#ifdef SI1133_AUTONOMOUS_ENABLED
+       ble_write("N needs forced mode\n");
+#else
+       uint32_t values[2] = {0, 0};
+       uint32_t count = 0;
+       for (uint32_t i = 2; count < 2 && ((s_string[i] >= '0' && s_string[i] <= '9') || s_string[i] == ','); i++) {
+           if (s_string[i] == ',') count++;
+           else values[count] = values[count] * 10 + (s_string[i] - 0x30);
+       }
+       //every period has to fit a whole forced conversion; a gated sensor would also have to boot
+       if (count == 1 && !si1133_power_gated() && values[1] * 1000 > si1133_conversion_us() + PWM_ACT_PER_MS * 1000
+           && letimer_burst_start(LETIMER0, values[0], values[1] * LETIMER_HZ / 1000, BURST_DONE_CB)) {
+           burst_samples = values[0];
+           burst_time_base = letimer_time_get();
+       }
+       else {
+           ble_write("N refused\n");
+       }
+#endif
+       return;
+   }
+
+   if (s_string[1] == RGB_CMD) {
+       uint32_t values[3] = {0, 0, 0};
+       uint32_t count = 0;
+       char string_rgb[50];
+       if (s_string[2] == '!') {
+           sprintf(string_rgb, "L r%lu g%lu b%lu\n", (unsigned long)rgb_level_get(COLOR_RED),
+                   (unsigned long)rgb_level_get(COLOR_GREEN), (unsigned long)rgb_level_get(COLOR_BLUE));
+           ble_write(string_rgb);
+           return;
+       }
+       for (uint32_t i = 2; count < 3 && ((s_string[i] >= '0' && s_string[i] <= '9') || s_string[i] == ','); i++) {
+           if (s_string[i] == ',') count++;
+           else values[count] = values[count] * 10 + (s_string[i] - 0x30);
+       }
+       values[0] &= COLOR_RED | COLOR_GREEN | COLOR_BLUE;
+       if (count == 1 && values[1] <= RGB_PWM_TOP) rgb_level_set(values[0], values[1]);
+       else if (count != 2 || values[1] > RGB_PWM_TOP || !rgb_fade_start(values[0], values[1], values[2])) ble_write("L refused\n");
+       return;
+   }
+
+   if (s_string[1] == CLOCK_CMD) {
+       app_clock_report();
+       return;
+   }
+
+   if (s_string[1] == RATE_CMD) {
+       uint32_t values[2] = {0, 0};
+       uint32_t count = 0;
+#ifdef SI1133_AUTONOMOUS_ENABLED
+       if (s_string[2] >= '0' && s_string[2] <= '9') {
+           ble_write("A needs forced mode\n");
+           return;
+       }
+#endif
+       if ((s_string[2] == '0' || s_string[2] == '1') && s_string[3] == '!') {
+           adaptive_rate = (s_string[2] == '1');
+           if (!adaptive_rate) {
+               letimer_period_set(LETIMER0, PWM_PER_TICKS);
+               app_power_policy();
+           }
+           app_rate_open(light_rate.min_period * 1000 / LETIMER_HZ, light_rate.max_period * 1000 / LETIMER_HZ);
+           return;
+       }
+       for (uint32_t i = 2; count < 2 && ((s_string[i] >= '0' && s_string[i] <= '9') || s_string[i] == ','); i++) {
+           if (s_string[i] == ',') count++;
+           else values[count] = values[count] * 10 + (s_string[i] - 0x30);
+       }
+       if (count == 1 && values[0] > 0 && values[0] <= values[1] && values[1] <= _LETIMER_COMP0_MASK * 1000 / LETIMER_HZ) {
+           app_rate_open(values[0], values[1]);
+       }
+       app_rate_report();
+       return;
+   }
+
+   if (s_string[1] == THRESHOLD_CMD) {
+#ifdef SI1133_AUTONOMOUS_ENABLED
+       if (s_string[2] == '0' || s_string[2] == '1') {
+           threshold_mode = (s_string[2] == '1');
+           //the sensor interrupts once per crossing, nothing to dwell on
+           hysteresis_tune(&light_hyst, READ_RES_TWENTY, READ_RES_TWENTY + LIGHT_HYSTERESIS, threshold_mode ? 0 : LIGHT_DWELL_MS);
+           if (threshold_mode) si1133_threshold_arm(!light_hyst.high);
+           else si1133_threshold_disarm();
+       }
+#else
+       ble_write("T needs autonomous mode\n");
+#endif
+       return;
+   }
+
+   if (s_string[1] == HYSTERESIS_CMD) {
+       uint32_t values[3] = {0, 0, 0};
+       uint32_t count = 0;
+       if (s_string[2] == 'C' || s_string[2] == 'A') {
+           light_hyst.report_on_change = (s_string[2] == 'C');
+           return;
+       }
+       for (uint32_t i = 2; count < 3 && ((s_string[i] >= '0' && s_string[i] <= '9') || s_string[i] == ','); i++) {
+           if (s_string[i] == ',') count++;
+           else values[count] = values[count] * 10 + (s_string[i] - 0x30);
+       }
+       if (threshold_mode) count = 0; //the thresholds written to the sensor decide
+       if (count == 2 && values[0] <= values[1]) hysteresis_tune(&light_hyst, values[0], values[1], values[2]);
+       app_hysteresis_report();
+       return;
+   }
+
+   if (s_string[1] == FILTER_CMD) {
+       if (s_string[2] >= '0' && s_string[2] < '0' + FILTER_TYPES) {
+           uint32_t param = 0;
+           for (uint32_t i = 3; s_string[i] >= '0' && s_string[i] <= '9'; i++) param = param * 10 + (s_string[i] - 0x30);
+           if (s_string[2] == '0' + FILTER_EMA && param <= FILTER_EMA_MAX_SHIFT) {
+               filter_open(&light_filter, FILTER_EMA, 1, param);
+           }
+           else if (param > 0 && param <= FILTER_MAX_TAPS) {
+               filter_open(&light_filter, s_string[2] - 0x30, param, 0);
+           }
+           return;
+       }
+       app_filter_benchmark();
+       return;
+   }
+
+   if (s_string[1] == BENCHMARK_CMD) {
+       app_lux_benchmark();
+       return;
+   }
+
+   if (s_string[1] == ARQ_PULL_CMD) {
+       if (s_string[2] >= '1' && s_string[2] <= '9') ble_arq_window_set(s_string[2] - 0x30);
+       ble_arq_send(trace_log, 2*trace_count, ARQ_DONE_CB, ARQ_RTO_CB);
+       return;
+   }
+
    if (s_string[1] == 'U') {
 
        if (s_string[2] == '+')
@@ -283,18 +820,231 @@ void scheduled_rx_cb(void) {
            change_speed = (((s_string[3] - 0x30)*100)+((s_string[4] - 0x30)*10)+(s_string[5] - 0x30));
            change_speed = change_speed * (-1);
          }
+       if (change_speed && !compare_set(LETIMER0, change_speed)) ble_write("U out of range\n");
+       else if (change_speed) app_power_policy();
+       app_period_report();
    }
 
-   compare_set(LETIMER0, change_speed);
 
 
+}
+
+
+
+
+
+
+
+
+
+/***************************************************************************//**
+ * @brief
+ *  Reports the illuminance and UV index of the last Si1133 read over BLE.
+ *
+ * @details
+ *  Both are computed in fixed point by the integer polynomial of the Si1133 driver and printed with two
+ *  decimals, without pulling floating point into the conversion.
+ ******************************************************************************/
+void app_lux_report(void) {
+  char string_lux[50];
+  int32_t lux, uvi;
 
+  si1133_result_get(&lux_result);
+  lux = si1133_lux_get(lux_result.value[2], lux_result.value[4], lux_result.value[3]);
+  uvi = si1133_uvi_get(lux_result.value[1]);
+  sprintf(string_lux, "lux %lu.%02lu UVI %lu.%02lu t%lu\n",
+          (unsigned long)(lux >> SI1133_LUX_FRACTION), (unsigned long)(((lux & ((1 << SI1133_LUX_FRACTION) - 1)) * 100) >> SI1133_LUX_FRACTION),
+          (unsigned long)(uvi >> SI1133_UV_FRACTION), (unsigned long)(((uvi & ((1 << SI1133_UV_FRACTION) - 1)) * 100) >> SI1133_UV_FRACTION),
+          (unsigned long)lux_result.timestamp);
+  ble_write(string_lux);
 }
 
+/***************************************************************************//**
+ * @brief
+ *  Times BENCHMARK_RUNS lux and UV index conversions of the last results with the cycle counter and
+ *  reports the minimum, average and maximum cycles of one conversion.
+ ******************************************************************************/
+void app_lux_benchmark(void) {
+  char string_bench[50];
+  BENCHMARK bench;
+  volatile int32_t sink; //keeps the conversions from being optimized away
 
+  benchmark_reset(&bench);
+  for (uint32_t i = 0; i < BENCHMARK_RUNS; i++) {
+      uint32_t start = benchmark_start();
+      sink = si1133_lux_get(lux_result.value[2], lux_result.value[4], lux_result.value[3]) + si1133_uvi_get(lux_result.value[1]);
+      benchmark_record(&bench, start);
+  }
+  (void)sink;
+  sprintf(string_bench, "lux cyc %lu/%lu/%lu\n", (unsigned long)bench.min,
+          (unsigned long)(bench.total / bench.runs), (unsigned long)bench.max);
+  ble_write(string_bench);
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Times BENCHMARK_RUNS samples through each filter type with the cycle counter and reports the
+ *  minimum, average and maximum cycles of one sample per stage.
+ *
+ * @details
+ *  The filters run at their largest history on varying input, so the median reports its worst
+ *  case sorted insertion. A scratch filter is used, the one in service keeps its history.
+ ******************************************************************************/
+void app_filter_benchmark(void) {
+  static const char * const names[FILTER_TYPES] = { "none", "avg", "med", "ema" };
+  char string_bench[50];
+  BENCHMARK bench;
+  FILTER scratch;
+  volatile uint32_t sink; //keeps the updates from being optimized away
+
+  for (uint32_t type = 0; type < FILTER_TYPES; type++) {
+      filter_open(&scratch, type, FILTER_MAX_TAPS, FILTER_EMA_MAX_SHIFT);
+      benchmark_reset(&bench);
+      for (uint32_t i = 0; i < BENCHMARK_RUNS; i++) {
+          uint32_t sample = (i * 7919) & 0xFFFF;
+          uint32_t start = benchmark_start();
+          sink = filter_update(&scratch, sample);
+          benchmark_record(&bench, start);
+      }
+      (void)sink;
+      sprintf(string_bench, "%s cyc %lu/%lu/%lu\n", names[type], (unsigned long)bench.min,
+              (unsigned long)(bench.total / bench.runs), (unsigned long)bench.max);
+      ble_write(string_bench);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Sends the summary of the light readings of the last window over BLE.
+ *
+ * @details
+ *  Sample count, minimum/maximum, mean and population variance, the last two with two decimals from
+ *  their STATS_FRACTION fixed point.
+ ******************************************************************************/
+void app_stats_report(void) {
+  char string_stats[50];
+  STATS_SUMMARY summary;
+  uint64_t frac_mask = (1 << STATS_FRACTION) - 1;
 
+  stats_summary_get(&light_stats, &summary);
+  sprintf(string_stats, "W%lu %lu/%lu m%lu.%02lu v%lu.%02lu\n", (unsigned long)summary.count,
+          (unsigned long)summary.min, (unsigned long)summary.max,
+          (unsigned long)(summary.mean >> STATS_FRACTION),
+          (unsigned long)(((summary.mean & frac_mask) * 100) >> STATS_FRACTION),
+          (unsigned long)(summary.variance >> STATS_FRACTION),
+          (unsigned long)(((summary.variance & frac_mask) * 100) >> STATS_FRACTION));
+  ble_write(string_stats);
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Sends the thresholds, dwell time and counters of the dark/light decision over BLE.
+ *
+ * @details
+ *  Falling/rising thresholds, dwell in ms, C or A for report on change or report all, then the number
+ *  of state changes and of readings that sent no message.
+ *
+ * @note
+ *  With threshold interrupts the thresholds live in the sensor as well, so #Hf,r,d! only reports.
+ ******************************************************************************/
+void app_hysteresis_report(void) {
+  char string_hyst[50];
 
+  sprintf(string_hyst, "H%lu/%lu d%lu %c chg %lu sup %lu\n", (unsigned long)light_hyst.falling,
+          (unsigned long)light_hyst.rising, (unsigned long)light_hyst.dwell,
+          light_hyst.report_on_change ? 'C' : 'A', (unsigned long)light_hyst.changes,
+          (unsigned long)light_hyst.suppressed);
+  ble_write(string_hyst);
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Restarts the adaptive sample period between min_ms and max_ms from the current LETIMER0 period.
+ *
+ * @details
+ *  The samples per hour and the charge saved are counted again from here.
+ ******************************************************************************/
+void app_rate_open(uint32_t min_ms, uint32_t max_ms) {
+  adaptive_open(&light_rate, min_ms * LETIMER_HZ / 1000, max_ms * LETIMER_HZ / 1000, letimer_period_get(LETIMER0),
+                RATE_CHANGE, RATE_STABLE_SAMPLES, RATE_HOLDOFF);
+  rate_time_base = letimer_time_get();
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Sends the sample period, its bounds, the samples per hour and the sensor charge saved over BLE.
+ *
+ * @details
+ *  The samples per hour are measured since the last app_rate_open() and compared with what the
+ *  fixed PWM_PER_MS would have taken in the same time. Each sample not taken saves
+ *  si1133_sample_charge() at PWM_PER_MS; the saving is reported in uC and as an average current in nA,
+ *  negative while the light keeps changing and the period stays below PWM_PER_MS. The MCU and BLE
+ *  cost per sample come on top and are not modelled.
+ ******************************************************************************/
+void app_rate_report(void) {
+  char string_rate[50];
+  uint32_t fixed_ms = PWM_PER_MS;
+  uint32_t elapsed_ms = (letimer_time_get() - rate_time_base) * 1000 / LETIMER_TIME_HZ;
+  uint32_t fixed_samples = elapsed_ms / fixed_ms;
+  int64_t saved = ((int64_t)fixed_samples - light_rate.samples) * (int64_t)si1133_sample_charge(fixed_ms); //nA ms
+
+  sprintf(string_rate, "A%c p%lu %lu-%lu chg %lu\n", adaptive_rate ? '1' : '0',
+          (unsigned long)letimer_period_get(LETIMER0), (unsigned long)light_rate.min_period,
+          (unsigned long)light_rate.max_period, (unsigned long)light_rate.changes);
+  ble_write(string_rate);
+  if (!elapsed_ms) return;
+  sprintf(string_rate, "s/h %lu/%lu sv %ld uC %ld nA\n",
+          (unsigned long)((uint64_t)light_rate.samples * 3600000 / elapsed_ms),
+          (unsigned long)(3600000 / fixed_ms), (long)(saved / 1000000), (long)(saved / elapsed_ms));
+  ble_write(string_rate);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Lets the Si1133 driver choose power gating again for the LETIMER0 period just set.
+ *
+ * @details
+ *  Only forced measurements started by the CPU can be gated; in autonomous mode and with the FORCE
+ *  written by the trigger loop the sensor stays powered. Nothing is chosen before the initialization
+ *  is done, scheduled_si1133_ready_cb() makes the first choice.
+ ******************************************************************************/
+void app_power_policy(void) {
+#if !defined(SI1133_AUTONOMOUS_ENABLED) && !defined(SI1133_TRIGGER_ENABLED)
+  if (si1133_ready() || si1133_power_gated()) si1133_power_policy(letimer_period_get(LETIMER0) * 1000 / LETIMER_HZ);
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Sends the LETIMER0 period and how long the last change took to take effect over BLE, in ticks.
+ ******************************************************************************/
+void app_period_report(void) {
+  char string_period[50];
+
+  sprintf(string_period, "U p%lu lat %lu t\n", (unsigned long)letimer_period_get(LETIMER0),
+          (unsigned long)letimer_period_latency_get());
+  ble_write(string_period);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Sends what each LETIMER0 clock policy gives for LETIMER_MAX_PERIOD_MS over BLE, the one in use marked.
+ *
+ * @details
+ *  Per policy: prescaler, counter rate, resolution in us, drift in ppm, current on top of the ULFRCO
+ *  in nA and the deepest energy mode the LETIMER keeps running in.
+ ******************************************************************************/
+void app_clock_report(void) {
+  char string_clock[50];
+  LETIMER_CLOCK_CONFIG config;
+
+  for (uint32_t policy = LETIMER_CLOCK_ULFRCO; policy <= LETIMER_CLOCK_LFXO; policy++) {
+      letimer_clock_config(policy, LETIMER_MAX_PERIOD_MS, &config);
+      sprintf(string_clock, "C%c%s /%lu %luHz %luus %luppm %lunA EM%lu\n",
+              (policy == LETIMER_CLOCK_POLICY) ? '*' : ' ', (policy == LETIMER_CLOCK_LFXO) ? "LFXO" : "ULF",
+              (unsigned long)(1 << config.prescaler), (unsigned long)config.hz,
+              (unsigned long)(config.resolution_ns / 1000), (unsigned long)config.drift_ppm,
+              (unsigned long)config.current_na, (unsigned long)config.lowest_em);
+      ble_write(string_clock);
+  }
+}
@@ -21,18 +21,26 @@
 #include "Si1133.h"
 #include "ble.h"
 #include "leuart.h"
+#include "benchmark.h"
+#include "filter.h"
+#include "stats.h"
+#include "hysteresis.h"
+#include "adaptive.h"
 
 //***********************************************************************************
 // defined files and defined variables
 //***********************************************************************************
-#define   PWM_PER         2.000   // PWM period in seconds
-#define   PWM_ACT_PER     0.002  // PWM active period in seconds
+#define   PWM_PER_MS      2000   // PWM period in milliseconds
+#define   PWM_ACT_PER_MS  2      // PWM active period in milliseconds
+#define   PWM_PER_TICKS   LETIMER_MS_TO_TICKS(PWM_PER_MS)
+#define   PWM_ACT_PER_TICKS LETIMER_MS_TO_TICKS(PWM_ACT_PER_MS)
 
 //Si1133 read variables defines
 #define   RETURN_READ       51 //This is the expected return read from the Si1133 and should be used for scheduled_si1133_read_cb(void) function
 #define   QUANTITY_BYTES    1 // only receiving 1 byte of information from the sensor
 #define   PART_ID_SI        0  //I2C Address for Part_ID on Si1133 Datasheet
 #define   READ_RES_TWENTY   20
+#define   LIGHT_HYSTERESIS  4   // counts above READ_RES_TWENTY needed to report light again after dark
 
 //Application scheduled events
 
@@ -44,6 +52,15 @@
 #define BOOT_UP_CB            0x00000010 //0b10000
 #define TX_CB                 0x00000020
 #define RX_CB                 0x00000040
+#define ARQ_DONE_CB           0x00000080
+#define BLE_LINK_CB           0x00000100
+#define SI1133_INT_CB         0x00000200
+#define SI1133_STEP_CB        0x00000400
+#define SI1133_READY_CB       0x00000800
+#define BURST_DONE_CB         0x00001000
+#define I2C_SERVICE_CB        0x00002000
+#define ARQ_RTO_CB            0x00004000
+#define SI1133_SAMPLE_CB      0x00008000
 //each callback is represented by a unique bit
 
 #define SYSTEM_BLOCK_EM       EM3
@@ -53,6 +70,35 @@
 
 #define BLE_MOD_NAME            "SONALBLE"
 
+//Trace log pulled off the device over the BLE ARQ link with the command #X!  (#Xn! also sets the window to n)
+#define TRACE_LOG_SAMPLES       128   // light readings kept, two bytes each, big endian
+#define ARQ_PULL_CMD            'X'
+#define LINK_STATS_CMD          'S'   // #S! reports transmissions and EM residency per link state
+#define I2C_SERVICE_INTERVAL    RTCC_MIN_TICKS   // i2c_service() runs from the RTCC at each I2C deadline, this late at most
+#define I2C_STATS_CMD           'I'   // #I! reports I2C interrupts per transaction and EM1 residency, #I0! / #I1! turn the LDMA off / on
+#define BENCHMARK_CMD           'B'   // #B! reports the cycles of one lux and UV index conversion
+#define BENCHMARK_RUNS          64
+#define OVERSAMPLE_CMD          'O'   // #Ocds! sets DECIM_RATE d and SW_GAIN s of Si1133 channel c
+#define FILTER_CMD              'F'   // #F! reports the cycles of each filter stage, #Ftn! selects filter type t with n taps (shift n for the EMA)
+#define LIGHT_FILTER_TYPE       FILTER_MEDIAN
+#define LIGHT_FILTER_TAPS       5
+#define LIGHT_FILTER_SHIFT      2
+#define STATS_CMD               'W'   // #WT! one summary per window, #WS! sliding windows, #W0! raw samples again
+#define STATS_WINDOW_SAMPLES    (60000 / PWM_PER_MS)   // one minute of samples
+#define STATS_SLIDING_HOP       (STATS_WINDOW_SAMPLES / 4)
+#define HYSTERESIS_CMD          'H'   // #H! reports thresholds and counters, #Hf,r,d! sets falling/rising thresholds and dwell ms, #HC! / #HA! report changes / all
+#define LIGHT_DWELL_MS          2000  // two samples in a row past a threshold before the LED follows
+#define THRESHOLD_CMD           'T'   // #T1! the Si1133 only interrupts on dark/light crossings, #T0! on every measurement again
+#define BURST_CMD               'N'   // #Nn,p! takes n samples every p ms, then goes back to the normal period
+#define CLOCK_CMD               'C'   // #C! reports resolution, drift and current of the ULFRCO and LFXO for LETIMER_MAX_PERIOD_MS
+#define RATE_CMD                'A'   // #A! reports the period, samples per hour and charge saved, #A0! / #A1! fixed / adaptive period, #An,x! bounds in ms
+#define RGB_CMD                 'L'   // #L! reports the RGB levels, #Lc,l! sets colors c (1 red, 2 green, 4 blue) to level l of 255, #Lc,l,t! fades them over t ms
+#define RATE_MIN_MS             500
+#define RATE_MAX_MS             30000
+#define RATE_CHANGE             3     // counts between two filtered readings that mean the light is changing
+#define RATE_STABLE_SAMPLES     4     // stable readings in a row before each back off step
+#define RATE_HOLDOFF            2     // readings at least between two period changes
+
 
 
 
@@ -72,5 +118,14 @@ void scheduled_si1133_read_cb(void);
 void scheduled_bootup_cb(void);
 void scheduled_rx_cb(void);
 void scheduled_tx_cb(void);
+void scheduled_arq_done_cb(void);
+void scheduled_arq_rto_cb(void);
+void scheduled_ble_link_cb(void);
+void scheduled_si1133_int_cb(void);
+void scheduled_si1133_step_cb(void);
+void scheduled_si1133_sample_cb(void);
+void scheduled_si1133_ready_cb(void);
+void scheduled_burst_done_cb(void);
+void scheduled_i2c_service_cb(void);
 
 #endif
@@ -0,0 +1,80 @@
+/**
+ * @file benchmark.c
+ * @author agent
+ * @date 10/18/2026
+ * @brief Cycle accurate timing of code sections with the DWT cycle counter of the Cortex-M4
+ *
+ */
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "benchmark.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *  Starts the DWT cycle counter.
+ *
+ * @details
+ *  The counter runs on the core clock and wraps every 2^32 cycles; benchmark_record() uses
+ *  unsigned differences so a wrap during a run does not matter.
+ ******************************************************************************/
+void benchmark_open(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Clears the runs recorded into a benchmark.
+ ******************************************************************************/
+void benchmark_reset(BENCHMARK *bench) {
+  bench->runs = 0;
+  bench->total = 0;
+  bench->min = UINT32_MAX;
+  bench->max = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns the cycle count at the start of a run, to be passed to benchmark_record().
+ ******************************************************************************/
+uint32_t benchmark_start(void) {
+  return DWT->CYCCNT;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Records the cycles elapsed since start as one run of a benchmark.
+ *
+ * @details
+ *  The couple of cycles taken by reading the counter are included; they are the same for every
+ *  run, so comparisons between two pieces of code are not affected.
+ ******************************************************************************/
+void benchmark_record(BENCHMARK *bench, uint32_t start) {
+  uint32_t cycles = DWT->CYCCNT - start;
+
+  bench->runs++;
+  bench->total += cycles;
+  if (cycles < bench->min) bench->min = cycles;
+  if (cycles > bench->max) bench->max = cycles;
+}
@@ -0,0 +1,42 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef BENCHMARK_HG
+#define BENCHMARK_HG
+
+/* System include statements */
+#include <stdint.h>
+
+/* Silicon Labs include statements */
+#include "em_device.h"
+
+/* The developer's include statements */
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+typedef struct { //cycle counts of the runs recorded into one benchmark
+  uint32_t runs;
+  uint32_t total; //cycles of all runs, for the average
+  uint32_t min;
+  uint32_t max;
+} BENCHMARK;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void benchmark_open(void);
+void benchmark_reset(BENCHMARK *bench);
+uint32_t benchmark_start(void);
+void benchmark_record(BENCHMARK *bench, uint32_t start);
+
+#endif
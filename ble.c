@@ -22,6 +22,28 @@
 //***********************************************************************************
 // private variables
 //***********************************************************************************
+static BLE_ARQ_STATE arq = { .window = BLE_ARQ_WINDOW };
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static const char * const link_patterns[] = { BLE_NOTI_LOST, BLE_NOTI_CONN, BLE_NOTI_SLEEP, BLE_NOTI_WAKE, BLE_PROBE_OK }; //BLE_LINK_STATE first
+static BLE_LINK_STATE link_state = BLE_LINK_DISCONNECTED;
+static bool link_probing; //AT sent, its OK would show that no central is connected
+static bool noti_pending; //AT+NOTI1 waits until the module is known to be disconnected
+static BLE_LINK_STATS link_stats;
+static uint32_t link_since; //time of the last link state change
+static uint32_t link_em_entries[MAX_ENERGY_MODES]; //sleep counters at the last link state change
+static uint32_t link_em_ticks[MAX_ENERGY_MODES];
+static char backlog[BLE_BACKLOG_DEPTH][BLE_STRING_MAX];
+static uint32_t backlog_head; //oldest string held back
+static uint32_t backlog_count;
+
+static bool pwr_enabled = true;
+static BLE_PWR_STATE pwr_state = BLE_PWR_AWAKE;
+static BLE_PWR_STATS pwr_stats;
+static uint32_t pwr_since; //time of the last power state change
+static uint32_t pwr_periods; //periods left before the module is woken up to advertise
+static uint32_t wake_chunks; //wake filler strings still to be sent
+static uint32_t wake_start;
 
 /***************************************************************************//**
  * @brief BLE module
@@ -37,6 +59,160 @@
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
+static void ble_arq_frame_send(uint32_t index);
+static uint32_t ble_hex_byte(char *hex);
+static void ble_link_account(uint32_t *em_entries, uint32_t *em_ticks, uint32_t now);
+static void ble_link_set(BLE_LINK_STATE state);
+static void ble_backlog_flush(void);
+static void ble_power_set(BLE_PWR_STATE state);
+
+/***************************************************************************//**
+ * @brief
+ *  Changes the HM-10 power state, adding the time spent in the state being left.
+ *
+ * @param[in] state
+ *  The new power state.
+ ******************************************************************************/
+void ble_power_set(BLE_PWR_STATE state) {
+  uint32_t now = letimer_time_get();
+
+  pwr_stats.time[pwr_state] += now - pwr_since;
+  pwr_since = now;
+  pwr_state = state;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Adds the time and sleep activity since the last link state change to the current state.
+ *
+ * @param[in] em_entries
+ *  Current energy mode entry counters from sleep_stats_get().
+ *
+ * @param[in] em_ticks
+ *  Current energy mode residency counters from sleep_stats_get().
+ *
+ * @param[in] now
+ *  Current letimer_time_get() value.
+ ******************************************************************************/
+void ble_link_account(uint32_t *em_entries, uint32_t *em_ticks, uint32_t now) {
+  link_stats.time[link_state] += now - link_since;
+  for (uint32_t i = 0; i < MAX_ENERGY_MODES; i++) {
+      link_stats.em_entries[link_state][i] += em_entries[i] - link_em_entries[i];
+      link_stats.em_ticks[link_state][i] += em_ticks[i] - link_em_ticks[i];
+      link_em_entries[i] = em_entries[i];
+      link_em_ticks[i] = em_ticks[i];
+  }
+  link_since = now;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Changes the link state, closing the accounting of the state being left.
+ *
+ * @param[in] state
+ *  The new link state.
+ ******************************************************************************/
+void ble_link_set(BLE_LINK_STATE state) {
+  uint32_t em_entries[MAX_ENERGY_MODES];
+  uint32_t em_ticks[MAX_ENERGY_MODES];
+
+  if (state == link_state) return;
+
+  sleep_stats_get(em_entries, em_ticks);
+  ble_link_account(em_entries, em_ticks, letimer_time_get());
+  link_state = state;
+  link_stats.transitions++;
+  if (state == BLE_LINK_CONNECTED && pwr_state != BLE_PWR_AWAKE) ble_power_set(BLE_PWR_AWAKE);
+
+  if (state == BLE_LINK_CONNECTED) ble_service();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Sends the oldest telemetry string held back while no central was connected.
+ *
+ * @details
+ *  Only one string is handed to the LEUART per call; the TX done event brings the
+ *  application back through ble_service() for the next one.
+ ******************************************************************************/
+void ble_backlog_flush(void) {
+  if (!backlog_count || link_state != BLE_LINK_CONNECTED || leuart_tx_busy()) return;
+
+  leuart_start(LEUART0, backlog[backlog_head], strlen(backlog[backlog_head]));
+  link_stats.tx_sent[BLE_LINK_CONNECTED]++;
+  backlog_head = (backlog_head + 1) % BLE_BACKLOG_DEPTH;
+  backlog_count--;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Builds frame number index of the current transfer and hands it to the LEUART.
+ *
+ * @details
+ *  The payload is hex encoded so the frame survives the string based LEUART driver, which
+ *  copies the data with strcpy and would stop at the first zero byte. The checksum is the
+ *  8 bit sum of the sequence number and the raw payload bytes.
+ *
+ * @param[in] index
+ *  Frame index within the transfer, the sequence number is its low byte.
+ ******************************************************************************/
+void ble_arq_frame_send(uint32_t index) {
+  char frame[2*BLE_ARQ_PAYLOAD + 7];
+  uint32_t offset = index * BLE_ARQ_PAYLOAD;
+  uint32_t count = arq.length - offset;
+  uint8_t seq = index & 0xFF;
+  uint8_t sum = seq;
+  uint32_t pos = 0;
+
+  if (count > BLE_ARQ_PAYLOAD) count = BLE_ARQ_PAYLOAD;
+
+  frame[pos++] = BLE_ARQ_SOF;
+  frame[pos++] = hex_digits[seq >> 4];
+  frame[pos++] = hex_digits[seq & 0x0F];
+  for (uint32_t i = 0; i < count; i++) {
+      uint8_t byte = arq.data[offset + i];
+      sum += byte;
+      frame[pos++] = hex_digits[byte >> 4];
+      frame[pos++] = hex_digits[byte & 0x0F];
+  }
+  frame[pos++] = hex_digits[sum >> 4];
+  frame[pos++] = hex_digits[sum & 0x0F];
+  frame[pos++] = BLE_ARQ_EOF;
+  frame[pos] = 0;
+
+  if (index == arq.base) {
+      arq.timer_start = rtcc_time_get();
+      rtcc_event(RTCC_CH_BLE_ARQ, BLE_ARQ_RTO, arq.rto_evt);
+  }
+  arq.stats.frames_sent++;
+  arq.stats.wire_bytes += pos;
+  link_stats.tx_sent[link_state]++;
+  leuart_start(LEUART0, frame, pos);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Converts two ASCII hex digits to a byte.
+ *
+ * @param[in] hex
+ *  Pointer to the first of the two digits.
+ *
+ * @return
+ *  The value 0-255, or a value above 255 if either character is not a hex digit.
+ ******************************************************************************/
+uint32_t ble_hex_byte(char *hex) {
+  uint32_t value = 0;
+
+  for (uint32_t i = 0; i < 2; i++) {
+      char c = hex[i];
+      value <<= 4;
+      if (c >= '0' && c <= '9') value |= c - '0';
+      else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+      else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+      else return 0x100;
+  }
+  return value;
+}
 
 /***************************************************************************//**
  * @brief
@@ -81,6 +257,7 @@ void ble_open(uint32_t tx_event, uint32_t rx_event){
   ble_open_values.refFreq = 0; //should be zero
 
   leuart_open(LEUART0, &ble_open_values);
+  rtcc_open(); //times the ARQ retransmissions
 
 }
 
@@ -90,14 +267,30 @@ void ble_open(uint32_t tx_event, uint32_t rx_event){
  *  The ble_write gets an input pointer to a string which is then send to the leuart_start function.
  * @details
  * In order to call the leuart_start function, you need to specify the specific LEUART peripheral you
- * want to choose and the input string itself.
+ * want to choose and the input string itself. While no central is connected the string is not sent,
+ * it is kept in a small backlog (oldest dropped first) that is flushed once the link is back. Until
+ * that backlog has drained, new strings queue behind it so the central gets them in order.
  * @param[in] * string
  * The input string that you want to write to the phone via bluetooth.
  ******************************************************************************/
 
 void ble_write(char* string){
   //uint32_t length_of_string = strlen(string);
+  if (link_state != BLE_LINK_CONNECTED || backlog_count) {
+      uint32_t slot = (backlog_head + backlog_count) % BLE_BACKLOG_DEPTH;
+      if (backlog_count == BLE_BACKLOG_DEPTH) {
+          backlog_head = (backlog_head + 1) % BLE_BACKLOG_DEPTH;
+          link_stats.tx_dropped++;
+      }
+      else backlog_count++;
+      strncpy(backlog[slot], string, BLE_STRING_MAX - 1);
+      backlog[slot][BLE_STRING_MAX - 1] = 0;
+      link_stats.tx_buffered++;
+      ble_backlog_flush();
+      return;
+  }
   leuart_start(LEUART0, string, strlen(string));
+  link_stats.tx_sent[BLE_LINK_CONNECTED]++;
 }
 
 /***************************************************************************//**
@@ -300,5 +493,412 @@ bool ble_test(char *mod_name){
 	return success;
 }
 
+/***************************************************************************//**
+ * @brief
+ *  Starts a reliable, windowed transfer of a buffer to the host.
+ *
+ * @details
+ *  The buffer is cut into BLE_ARQ_PAYLOAD byte frames and sent with a Go-Back-N sliding
+ *  window. Up to the configured window of frames are put on the wire back to back without
+ *  waiting for an ACK so the 9600 baud link stays busy. The host acknowledges cumulatively
+ *  with #Kss!, and if the oldest outstanding frame is not acknowledged within BLE_ARQ_RTO
+ *  ticks every outstanding frame is sent again.
+ *
+ * @note
+ *  The buffer is not copied and must stay untouched until done_evt is scheduled. Frames are
+ *  pumped from ble_arq_service(), which the application calls from its LEUART TX done
+ *  callback, from its periodic LETIMER callbacks and from rto_evt.
+ *
+ * @param[in] data
+ *  Buffer to transfer.
+ *
+ * @param[in] length
+ *  Number of bytes in the buffer.
+ *
+ * @param[in] done_evt
+ *  Scheduled event posted once the host has acknowledged every frame.
+ *
+ * @param[in] rto_evt
+ *  Scheduled event posted by the RTCC BLE_ARQ_RTO after the oldest unacknowledged frame was
+ *  sent, its handler must call ble_service()
+ *
+ * @return
+ *  false if a transfer is already in progress.
+ ******************************************************************************/
+bool ble_arq_send(const uint8_t *data, uint32_t length, uint32_t done_evt, uint32_t rto_evt) {
+  if (arq.active) return false;
+
+  arq.data = data;
+  arq.length = length;
+  arq.frames = length / BLE_ARQ_PAYLOAD + 1;
+  arq.base = 0;
+  arq.next = 0;
+  arq.done_evt = done_evt;
+  arq.rto_evt = rto_evt;
+  memset(&arq.stats, 0, sizeof(arq.stats));
+  arq.stats.start_time = letimer_time_get();
+  arq.active = true;
+
+  ble_arq_service();
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Moves the ARQ sender forward: retransmits on timeout and fills the window.
+ *
+ * @details
+ *  If the oldest outstanding frame has timed out, the sender goes back to it and every
+ *  frame in flight is counted as a retransmission. The timeout is armed on the RTCC when that
+ *  frame is sent, so the rto_evt of ble_arq_send() brings the application here on time
+ *  whatever the LETIMER period. Then, if the LEUART is idle and the
+ *  window has room, the next frame is handed to the LEUART. Only one frame is queued per
+ *  call since the LEUART driver holds a single string; the TX done event brings the
+ *  application back here for the next one.
+ ******************************************************************************/
+void ble_arq_service(void) {
+  if (!arq.active) return;
+
+  if ((arq.next != arq.base) && (rtcc_time_get() - arq.timer_start >= BLE_ARQ_RTO)) {
+      arq.stats.retransmits += arq.next - arq.base;
+      arq.next = arq.base;
+  }
+
+  if (leuart_tx_busy() || link_state != BLE_LINK_CONNECTED) return;
+
+  if ((arq.next < arq.frames) && (arq.next - arq.base < arq.window)) {
+      ble_arq_frame_send(arq.next);
+      arq.next++;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Offers a received command string to the ARQ sender.
+ *
+ * @details
+ *  A cumulative ACK #Kss! acknowledges every frame before sequence number ss. The sequence
+ *  number is mapped back onto the outstanding frames; ACKs that do not fall inside the
+ *  window are stale duplicates and are ignored. When the last frame is acknowledged the
+ *  statistics are closed and done_evt is scheduled.
+ *
+ * @param[in] rx_string
+ *  The received command, including the start and signal frame characters.
+ *
+ * @return
+ *  true if the string was an ARQ ACK and has been consumed.
+ ******************************************************************************/
+bool ble_arq_rx(char *rx_string) {
+  uint32_t seq;
+  uint32_t acked;
+
+  if (rx_string[1] != BLE_ARQ_ACK) return false;
+  seq = ble_hex_byte(&rx_string[2]);
+  if (!arq.active || seq > 0xFF) return true;
+
+  acked = arq.base + ((seq - arq.base) & 0xFF);
+  if (acked <= arq.base || acked > arq.next) return true;
+
+  arq.stats.bytes_acked = acked * BLE_ARQ_PAYLOAD;
+  if (arq.stats.bytes_acked > arq.length) arq.stats.bytes_acked = arq.length;
+  arq.stats.acks++;
+  arq.base = acked;
+  arq.timer_start = rtcc_time_get();
+  if (arq.next != arq.base) rtcc_event(RTCC_CH_BLE_ARQ, BLE_ARQ_RTO, arq.rto_evt); //restarted for the new oldest frame
+  else rtcc_event_cancel(RTCC_CH_BLE_ARQ);
+
+  if (arq.base == arq.frames) {
+      arq.active = false;
+      arq.stats.elapsed = letimer_time_get() - arq.stats.start_time;
+      if (arq.stats.elapsed) arq.stats.throughput = arq.stats.bytes_acked * LETIMER_TIME_HZ / arq.stats.elapsed;
+      add_scheduled_event(arq.done_evt);
+      return true;
+  }
+
+  ble_arq_service();
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns whether an ARQ transfer is in progress.
+ ******************************************************************************/
+bool ble_arq_busy(void) {
+  return arq.active;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Sets the number of frames the ARQ sender may have in flight.
+ *
+ * @details
+ *  A window of 1 is stop-and-wait. The window is clamped to 1..BLE_ARQ_MAX_WINDOW and takes
+ *  effect on the next frame sent.
+ *
+ * @param[in] window
+ *  Frames allowed in flight.
+ ******************************************************************************/
+void ble_arq_window_set(uint32_t window) {
+  if (window < 1) window = 1;
+  if (window > BLE_ARQ_MAX_WINDOW) window = BLE_ARQ_MAX_WINDOW;
+  arq.window = window;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Copies the statistics of the current or last ARQ transfer.
+ *
+ * @details
+ *  throughput is filled in when a transfer completes and can be compared against
+ *  BLE_LINK_BYTES_PER_SEC, the raw rate of the 9600 baud link. With hex encoding a full
+ *  frame carries BLE_ARQ_PAYLOAD bytes in 2*BLE_ARQ_PAYLOAD + 6 characters, which bounds the
+ *  best case payload rate.
+ *
+ * @param[out] stats
+ *  Destination for the statistics.
+ ******************************************************************************/
+void ble_arq_stats(BLE_ARQ_STATS *stats) {
+  *stats = arq.stats;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Starts tracking the HM-10 connection state.
+ *
+ * @details
+ *  The module is told to report connections with AT+NOTI1, after which it sends OK+CONN
+ *  when a central connects and OK+LOST when it disconnects. Neither string carries the
+ *  start frame, so the LEUART idle pattern matcher is used to pick them up between
+ *  command frames. The link starts out disconnected and telemetry is held back until the
+ *  module reports a connection or a command arrives from the phone.
+ *
+ * @note
+ *  A reset of the MCU does not reset the module, so a central may still be connected, and
+ *  the module would pass an AT command on to it as data. The short AT probe goes first: only
+ *  a module that is not connected answers it with OK, and AT+NOTI1 is sent from ble_service()
+ *  after that answer or after an OK+LOST. Without an answer within a LETIMER period, or with a
+ *  command frame from the phone, the link is taken as connected and AT+NOTI1 waits for the
+ *  OK+LOST, which the module still sends when the setting was stored by an earlier run.
+ *
+ * @param[in] link_evt
+ *  Scheduled event posted when a notification has been received, the application then
+ *  calls ble_link_update().
+ ******************************************************************************/
+void ble_link_open(uint32_t link_evt) {
+  sleep_stats_get(link_em_entries, link_em_ticks);
+  link_since = letimer_time_get();
+  pwr_since = link_since;
+  leuart_idle_match_open(LEUART0, link_patterns, sizeof(link_patterns) / sizeof(link_patterns[0]), link_evt);
+  link_probing = true;
+  noti_pending = true;
+  leuart_start(LEUART0, BLE_PROBE_CMD, strlen(BLE_PROBE_CMD));
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Applies the last notification received from the HM-10.
+ *
+ * @details
+ *  OK+CONN and OK+LOST change the link state. OK+SLEEP confirms that the module went to
+ *  sleep and OK+WAKE that it woke up, which also closes the wake latency measurement. A plain
+ *  OK only counts as the answer to the AT probe; every other reply of the module starts with
+ *  OK as well and is matched again once complete.
+ ******************************************************************************/
+void ble_link_update(void) {
+  uint32_t match = leuart_idle_match_get();
+
+  if (match < BLE_LINK_STATES) {
+      link_probing = false;
+      ble_link_set((BLE_LINK_STATE)match);
+      ble_service();
+  }
+  else if (match == BLE_LINK_STATES + 2 && link_probing) {
+      link_probing = false;
+      ble_service();
+  }
+  else if (match == BLE_LINK_STATES && pwr_state == BLE_PWR_SLEEP_PENDING) {
+      ble_power_set(BLE_PWR_ASLEEP);
+      pwr_stats.sleeps++;
+  }
+  else if (match == BLE_LINK_STATES + 1 && pwr_state == BLE_PWR_WAKING) {
+      pwr_stats.wake_latency_last = letimer_time_get() - wake_start;
+      if (pwr_stats.wake_latency_last > pwr_stats.wake_latency_max) pwr_stats.wake_latency_max = pwr_stats.wake_latency_last;
+      pwr_stats.wakes++;
+      ble_power_set(BLE_PWR_AWAKE);
+      ble_service();
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Marks the link connected because a command frame arrived from the phone.
+ *
+ * @details
+ *  Covers a central that was already connected when the MCU was reset, in which case the
+ *  module never sends OK+CONN.
+ ******************************************************************************/
+void ble_link_rx_seen(void) {
+  link_probing = false;
+  ble_link_set(BLE_LINK_CONNECTED);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns the current link state.
+ ******************************************************************************/
+BLE_LINK_STATE ble_link_state(void) {
+  return link_state;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Copies the per link state transmission and energy mode statistics.
+ *
+ * @details
+ *  The interval since the last state change is added to the current state first, so the
+ *  numbers are up to date when they are read.
+ *
+ * @param[out] stats
+ *  Destination for the statistics.
+ ******************************************************************************/
+void ble_link_stats(BLE_LINK_STATS *stats) {
+  uint32_t em_entries[MAX_ENERGY_MODES];
+  uint32_t em_ticks[MAX_ENERGY_MODES];
+
+  sleep_stats_get(em_entries, em_ticks);
+  ble_link_account(em_entries, em_ticks, letimer_time_get());
+  *stats = link_stats;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Gives the BLE module its next transmission when the LEUART is idle.
+ *
+ * @details
+ *  While the module is waking up the wake filler goes out first, and nothing else is sent
+ *  until the module is awake. A pending AT+NOTI1 goes out as soon as the module is known to
+ *  be disconnected. Then held back telemetry goes first, then the ARQ sender.
+ *  The application calls this from its LEUART TX done callback and its periodic LETIMER
+ *  callbacks.
+ ******************************************************************************/
+void ble_service(void) {
+  if (pwr_state == BLE_PWR_WAKING && wake_chunks && !leuart_tx_busy()) {
+      wake_chunks--;
+      leuart_start(LEUART0, BLE_WAKE_CHUNK, strlen(BLE_WAKE_CHUNK));
+      return;
+  }
+  if (pwr_state != BLE_PWR_AWAKE) return;
+  if (noti_pending && !link_probing && link_state == BLE_LINK_DISCONNECTED) {
+      if (leuart_tx_busy()) return;
+      noti_pending = false;
+      leuart_start(LEUART0, BLE_NOTI_ON_CMD, strlen(BLE_NOTI_ON_CMD));
+      return;
+  }
+  ble_backlog_flush();
+  ble_arq_service();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Enables or disables HM-10 sleep management.
+ *
+ * @details
+ *  When disabled the module is woken up if needed and then left awake, which is the
+ *  behavior of the module out of reset.
+ *
+ * @param[in] enable
+ *  true to let ble_power_idle() put the module to sleep.
+ ******************************************************************************/
+void ble_power_enable(bool enable) {
+  pwr_enabled = enable;
+  if (!enable) pwr_periods = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Called once per LETIMER period ahead of the scheduled telemetry.
+ *
+ * @details
+ *  While the module sleeps this counts down the sleep periods. When they run out, or when
+ *  sleep management has been disabled, the wake-on-data filler is started so the module
+ *  is awake and advertising by the time the telemetry of this period is produced.
+ *
+ * @note
+ *  A confirmation that did not arrive within a period is not waited on forever: a module
+ *  still waking is taken as awake, and one that did not confirm AT+SLEEP as asleep, which
+ *  is the safe side since the wake filler is harmless to an awake module. An AT probe left
+ *  unanswered means a central is connected.
+ ******************************************************************************/
+void ble_power_period(void) {
+  if (link_probing) {
+      link_probing = false;
+      ble_link_set(BLE_LINK_CONNECTED);
+  }
+  if (pwr_state == BLE_PWR_WAKING && !wake_chunks) {
+      ble_power_set(BLE_PWR_AWAKE);
+      ble_service();
+  }
+  if (pwr_state == BLE_PWR_SLEEP_PENDING) ble_power_set(BLE_PWR_ASLEEP);
+  if (pwr_state != BLE_PWR_ASLEEP) return;
+  if (pwr_periods) pwr_periods--;
+  if (pwr_periods && pwr_enabled) return;
+
+  wake_chunks = BLE_WAKE_CHUNKS;
+  wake_start = letimer_time_get();
+  ble_power_set(BLE_PWR_WAKING);
+  ble_service();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Called after the telemetry of a period has been produced, the start of an idle stretch.
+ *
+ * @details
+ *  The module is put to sleep with AT+SLEEP when sleep management is enabled, no central
+ *  is connected, and nothing is on its way over the LEUART. Telemetry held in the backlog
+ *  does not keep the module awake: it waits for a central, and a central connecting wakes
+ *  the module, which ble_link_set() marks awake before it drains the backlog. The AT command is only
+ *  interpreted by the module while it is not connected, and a central connecting later
+ *  wakes the module up on its own. The module is woken again after BLE_SLEEP_PERIODS
+ *  periods so it keeps advertising on a low duty cycle.
+ ******************************************************************************/
+void ble_power_idle(void) {
+  if (!pwr_enabled || pwr_state != BLE_PWR_AWAKE || link_state != BLE_LINK_DISCONNECTED) return;
+  if (link_probing || noti_pending || arq.active || leuart_tx_busy()) return;
 
+  pwr_periods = BLE_SLEEP_PERIODS;
+  ble_power_set(BLE_PWR_SLEEP_PENDING);
+  leuart_start(LEUART0, BLE_SLEEP_CMD, strlen(BLE_SLEEP_CMD));
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Returns the current HM-10 power state.
+ ******************************************************************************/
+BLE_PWR_STATE ble_power_state(void) {
+  return pwr_state;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Copies the HM-10 power statistics.
+ *
+ * @details
+ *  The time of the current state is closed first. The average current is estimated from
+ *  the time the module spent sleeping, at BLE_CURRENT_SLEEP_UA, and the time in any other
+ *  state, at BLE_CURRENT_AWAKE_UA. Read it next to sleep_stats_get() for the MCU side.
+ *
+ * @param[out] stats
+ *  Destination for the statistics.
+ ******************************************************************************/
+void ble_power_stats(BLE_PWR_STATS *stats) {
+  uint64_t charge;
+  uint32_t total = 0;
+
+  ble_power_set(pwr_state);
+  for (uint32_t i = 0; i < BLE_PWR_STATES; i++) total += pwr_stats.time[i];
+  charge = (uint64_t)pwr_stats.time[BLE_PWR_ASLEEP] * BLE_CURRENT_SLEEP_UA +
+           (uint64_t)(total - pwr_stats.time[BLE_PWR_ASLEEP]) * BLE_CURRENT_AWAKE_UA;
+  pwr_stats.average_ua = total ? (uint32_t)(charge / total) : BLE_CURRENT_AWAKE_UA;
+  *stats = pwr_stats;
+}
@@ -17,6 +17,8 @@
 // Driver functions
 #include "leuart.h"
 #include "gpio.h"
+#include "letimer.h"
+#include "rtcc.h"
 #include "brd_config.h"
 
 #define STARTTFRAME            "#"
@@ -25,9 +27,101 @@
 // defined files
 //***********************************************************************************
 
+// Sliding window ARQ transfer over the HM-10 link
+//  Device -> host data frame:  @ SS PP..PP CC \n   (all hex digits)
+//    SS     sequence number of the frame, modulo 256
+//    PP..PP up to BLE_ARQ_PAYLOAD bytes of payload, two hex digits per byte
+//    CC     8 bit sum of the sequence number and the payload bytes
+//    A frame carrying less than BLE_ARQ_PAYLOAD bytes ends the transfer
+//  Host -> device ACK: #Kss!  ss = next sequence number expected (cumulative)
+#define BLE_ARQ_SOF             '@'
+#define BLE_ARQ_EOF             '\n'
+#define BLE_ARQ_ACK             'K'
+#define BLE_ARQ_PAYLOAD         16      // payload bytes per frame, 38 characters on the wire
+#define BLE_ARQ_MAX_WINDOW      8       // frames in flight, must stay well below 128
+#define BLE_ARQ_WINDOW          4       // default window
+#define BLE_ARQ_RTO             500     // retransmission timeout in RTCC ticks (ms)
+#define BLE_LINK_BYTES_PER_SEC  (HM10_BAUDRATE / 10)   // 8N1, raw link rate
+
+// HM-10 connection notifications, enabled with AT+NOTI1 once the module answered the AT probe
+#define BLE_PROBE_CMD           "AT"    // answered with OK only while no central is connected
+#define BLE_PROBE_OK            "OK"
+#define BLE_NOTI_ON_CMD         "AT+NOTI1"
+#define BLE_NOTI_CONN           "OK+CONN"
+#define BLE_NOTI_LOST           "OK+LOST"
+#define BLE_BACKLOG_DEPTH       4       // telemetry strings kept while no central is connected
+#define BLE_NOTI_SLEEP          "OK+SLEEP"
+#define BLE_NOTI_WAKE           "OK+WAKE"
+
+// HM-10 low power management, the module is only put to sleep while no central is connected
+#define BLE_SLEEP_CMD           "AT+SLEEP"
+#define BLE_WAKE_CHUNK          "IIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIIII"  // wake-on-data filler
+#define BLE_WAKE_CHUNKS         2       // the module wakes on a string longer than 80 characters
+#define BLE_SLEEP_PERIODS       4       // LETIMER periods the module sleeps before it advertises again
+#define BLE_CURRENT_AWAKE_UA    8500    // HM-10 estimated current, awake and advertising or connected
+#define BLE_CURRENT_SLEEP_UA    400     // HM-10 estimated current in sleep mode
+#define BLE_STRING_MAX          50      // matches the LEUART driver string buffer
+
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+typedef struct {
+  uint32_t  frames_sent;      // every frame put on the wire, including retransmissions
+  uint32_t  retransmits;      // frames sent again after a timeout
+  uint32_t  acks;             // ACKs that advanced the window
+  uint32_t  bytes_acked;      // payload bytes confirmed by the host
+  uint32_t  wire_bytes;       // characters put on the wire
+  uint32_t  start_time;       // letimer_time_get() when the transfer started
+  uint32_t  elapsed;          // ticks from start until the last ACK
+  uint32_t  throughput;       // payload bytes per second of the last transfer
+} BLE_ARQ_STATS;
+
+typedef enum {
+  BLE_LINK_DISCONNECTED,
+  BLE_LINK_CONNECTED,
+  BLE_LINK_STATES
+} BLE_LINK_STATE;
+
+typedef enum {
+  BLE_PWR_AWAKE,
+  BLE_PWR_SLEEP_PENDING,   // AT+SLEEP sent, waiting for OK+SLEEP
+  BLE_PWR_ASLEEP,
+  BLE_PWR_WAKING,          // wake filler sent, waiting for OK+WAKE
+  BLE_PWR_STATES
+} BLE_PWR_STATE;
+
+typedef struct {  //HM-10 power accounting, times in LETIMER ticks
+  uint32_t  time[BLE_PWR_STATES];
+  uint32_t  sleeps;
+  uint32_t  wakes;
+  uint32_t  wake_latency_last;     // wake filler start to OK+WAKE
+  uint32_t  wake_latency_max;
+  uint32_t  average_ua;            // estimated module current over the time tracked
+} BLE_PWR_STATS;
+
+typedef struct {  //per link state accounting, indexed by BLE_LINK_STATE
+  uint32_t  tx_sent[BLE_LINK_STATES];                     // strings put on the wire
+  uint32_t  tx_buffered;                                  // telemetry held back while disconnected
+  uint32_t  tx_dropped;                                   // held back telemetry overwritten by newer strings
+  uint32_t  time[BLE_LINK_STATES];                        // LETIMER ticks spent in each state
+  uint32_t  em_entries[BLE_LINK_STATES][MAX_ENERGY_MODES];
+  uint32_t  em_ticks[BLE_LINK_STATES][MAX_ENERGY_MODES];
+  uint32_t  transitions;
+} BLE_LINK_STATS;
+
+typedef struct {  //Go-Back-N sender state, frames are indexed from 0, the sequence number is the index modulo 256
+  const uint8_t *data;        // caller owned buffer, must stay valid until done_evt
+  uint32_t  length;           // bytes to transfer
+  uint32_t  frames;           // frames in this transfer, including a short or empty last frame
+  uint32_t  base;             // oldest frame not acknowledged yet
+  uint32_t  next;             // next frame to put on the wire
+  uint32_t  window;           // frames allowed in flight
+  uint32_t  timer_start;      // rtcc_time_get() when the oldest outstanding frame was sent
+  uint32_t  done_evt;         // scheduled event posted when every frame is acknowledged
+  uint32_t  rto_evt;          // scheduled event posted by the RTCC when the oldest frame times out
+  bool      active;
+  BLE_ARQ_STATS stats;
+} BLE_ARQ_STATE;
 
 
 //***********************************************************************************
@@ -38,4 +132,24 @@ void ble_write(char *string);
 
 bool ble_test(char *mod_name);
 
+bool ble_arq_send(const uint8_t *data, uint32_t length, uint32_t done_evt, uint32_t rto_evt);
+void ble_arq_service(void);
+bool ble_arq_rx(char *rx_string);
+bool ble_arq_busy(void);
+void ble_arq_window_set(uint32_t window);
+void ble_arq_stats(BLE_ARQ_STATS *stats);
+
+void ble_link_open(uint32_t link_evt);
+void ble_link_update(void);
+void ble_link_rx_seen(void);
+BLE_LINK_STATE ble_link_state(void);
+void ble_link_stats(BLE_LINK_STATS *stats);
+void ble_service(void);
+
+void ble_power_enable(bool enable);
+void ble_power_period(void);
+void ble_power_idle(void);
+BLE_PWR_STATE ble_power_state(void);
+void ble_power_stats(BLE_PWR_STATS *stats);
+
 #endif
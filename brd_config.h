@@ -64,6 +64,8 @@
 #define SI1133_SDA_PIN          4
 #define SI1133_SENSOR_EN_PORT   gpioPortF
 #define SI1133_SENSOR_EN_PIN    9
+#define SI1133_INT_PORT         gpioPortF   // open drain, active low interrupt output of the Si1133
+#define SI1133_INT_PIN          11
 //#define STRONG_DRIVE
 
 #ifdef STRONG_DRIVE
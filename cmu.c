@@ -9,6 +9,7 @@
 // Include files
 //***********************************************************************************
 #include "cmu.h"
+#include "letimer.h"
 
 //***********************************************************************************
 // defined files
@@ -65,7 +66,7 @@ void cmu_open(void){
     // Route LF clock to the LF clock tree
     // What is the enumeration required to placed the ULFRCO onto the proper clock branch?
     // It can be found in the online HAL documentation
-    CMU_ClockSelectSet(cmuClock_LFA  , cmuSelect_ULFRCO);    // routing ULFRCO to proper Low Freq clock tree
+    CMU_ClockSelectSet(cmuClock_LFA  , LETIMER_LFA_SELECT);    // routing ULFRCO, or the LFXO for accuracy, to proper Low Freq clock tree
     CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_LFXO);
 
     // What is the proper enumeration to enable the clock tree onto the LE clock branches?
@@ -0,0 +1,158 @@
+/**
+ * @file filter.c
+ * @author agent
+ * @date 10/18/2026
+ * @brief Integer sample filters: moving average, median of N and exponential filter
+ *
+ */
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "filter.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void filter_sorted_replace(FILTER *filter, uint32_t old_sample, uint32_t sample);
+static void filter_sorted_insert(FILTER *filter, uint32_t sample);
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *  Sets up a filter and empties its history.
+ *
+ * @details
+ *  All filters work on unsigned 16 bit samples in integer arithmetic over the fixed ring buffer of
+ *  the FILTER, so nothing is allocated and the cost of one sample is bounded by FILTER_MAX_TAPS.
+ *
+ * @param[in] filter
+ *  Filter to set up
+ *
+ * @param[in] type
+ *  Moving average, median, exponential filter or none
+ *
+ * @param[in] taps
+ *  Samples averaged or ranked by the moving average and the median, 1 to FILTER_MAX_TAPS
+ *
+ * @param[in] shift
+ *  Exponential filter weight of a new sample, 2^-shift with shift 0 to FILTER_EMA_MAX_SHIFT
+ ******************************************************************************/
+void filter_open(FILTER *filter, FILTER_TYPE type, uint32_t taps, uint32_t shift) {
+  EFM_ASSERT(type < FILTER_TYPES);
+  EFM_ASSERT(taps > 0 && taps <= FILTER_MAX_TAPS);
+  EFM_ASSERT(shift <= FILTER_EMA_MAX_SHIFT);
+  filter->type = type;
+  filter->taps = taps;
+  filter->shift = shift;
+  filter->head = 0;
+  filter->count = 0;
+  filter->sum = 0;
+  filter->ema = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Adds a sample to a filter and returns the filtered value.
+ *
+ * @details
+ *  The moving average keeps a running sum, adding the new sample and dropping the oldest, so it
+ *  costs one division whatever the length. The median keeps a sorted copy of the ring buffer in
+ *  which the oldest sample is replaced by the new one, at most taps moves. The exponential filter
+ *  adds (sample - state) * 2^-shift in fixed point and needs no history. Until the ring is full
+ *  the first two work over the samples received so far, and the exponential filter starts from
+ *  the first sample.
+ *
+ * @param[in] filter
+ *  Filter set up with filter_open()
+ *
+ * @param[in] sample
+ *  New sample, up to 16 bits
+ *
+ * @return
+ *  The filtered value
+ ******************************************************************************/
+uint32_t filter_update(FILTER *filter, uint32_t sample) {
+  uint32_t old_sample = filter->ring[filter->head];
+  bool full = filter->count == filter->taps;
+
+  EFM_ASSERT(sample <= 0xFFFF);
+  switch (filter->type) {
+    case FILTER_MOVING_AVERAGE:
+      if (full) filter->sum -= old_sample;
+      else filter->count++;
+      filter->sum += sample;
+      break;
+    case FILTER_MEDIAN:
+      if (full) filter_sorted_replace(filter, old_sample, sample);
+      else filter_sorted_insert(filter, sample);
+      if (!full) filter->count++;
+      break;
+    case FILTER_EMA:
+      if (filter->count == 0) {
+          filter->ema = sample << FILTER_EMA_FRACTION;
+          filter->count = 1;
+      }
+      else {
+          int32_t delta = (int32_t)(sample << FILTER_EMA_FRACTION) - (int32_t)filter->ema;
+          filter->ema += delta / (1 << filter->shift); //rounds toward zero, so the state settles on a constant input
+      }
+      return (filter->ema + (1 << (FILTER_EMA_FRACTION - 1))) >> FILTER_EMA_FRACTION;
+    default:
+      return sample;
+  }
+  filter->ring[filter->head] = sample;
+  filter->head = (filter->head + 1) % filter->taps;
+
+  if (filter->type == FILTER_MOVING_AVERAGE) return (filter->sum + filter->count / 2) / filter->count;
+  return filter->sorted[filter->count / 2]; //upper median for an even count
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Inserts a sample into the sorted copy while the ring is filling.
+ ******************************************************************************/
+void filter_sorted_insert(FILTER *filter, uint32_t sample) {
+  uint32_t i = filter->count;
+
+  while (i > 0 && filter->sorted[i - 1] > sample) {
+      filter->sorted[i] = filter->sorted[i - 1];
+      i--;
+  }
+  filter->sorted[i] = sample;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Replaces the oldest sample by the new one in the sorted copy, keeping it sorted.
+ *
+ * @details
+ *  The slot of the oldest sample is moved towards the place of the new one, shifting the samples
+ *  in between by one, so the whole update stays within taps moves.
+ ******************************************************************************/
+void filter_sorted_replace(FILTER *filter, uint32_t old_sample, uint32_t sample) {
+  uint32_t i = 0;
+
+  while (filter->sorted[i] != old_sample) i++;
+  while (i > 0 && filter->sorted[i - 1] > sample) {
+      filter->sorted[i] = filter->sorted[i - 1];
+      i--;
+  }
+  while (i < filter->count - 1 && filter->sorted[i + 1] < sample) {
+      filter->sorted[i] = filter->sorted[i + 1];
+      i++;
+  }
+  filter->sorted[i] = sample;
+}
@@ -0,0 +1,58 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef FILTER_HG
+#define FILTER_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+#define FILTER_MAX_TAPS       15    // ring buffer length, bounds the moving average and the median
+#define FILTER_EMA_FRACTION   8     // fractional bits of the exponential filter state
+#define FILTER_EMA_MAX_SHIFT  7     // alpha down to 1/128
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+typedef enum {
+  FILTER_NONE, //samples pass through unchanged
+  FILTER_MOVING_AVERAGE, //mean of the last taps samples
+  FILTER_MEDIAN, //median of the last taps samples
+  FILTER_EMA, //exponential filter, alpha = 2^-shift
+  FILTER_TYPES
+} FILTER_TYPE;
+
+typedef struct {
+  FILTER_TYPE type;
+  uint32_t taps; //samples kept, 1 to FILTER_MAX_TAPS
+  uint32_t shift; //exponential filter alpha = 2^-shift
+  uint32_t ring[FILTER_MAX_TAPS]; //last samples, oldest at head once full
+  uint32_t sorted[FILTER_MAX_TAPS]; //the same samples in ascending order, for the median
+  uint32_t head;
+  uint32_t count; //samples in the ring, up to taps
+  uint32_t sum; //of the samples in the ring, for the moving average
+  uint32_t ema; //exponential filter state, FILTER_EMA_FRACTION fractional bits
+} FILTER;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void filter_open(FILTER *filter, FILTER_TYPE type, uint32_t taps, uint32_t shift);
+uint32_t filter_update(FILTER *filter, uint32_t sample);
+
+#endif
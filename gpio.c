@@ -19,11 +19,13 @@
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+static uint32_t gpio_int_evt[GPIO_INT_LINES]; //scheduled event posted by each external interrupt line
 
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
+static void gpio_int_dispatch(uint32_t lines);
 
 
 //***********************************************************************************
@@ -69,6 +71,7 @@ void gpio_open(void){
 	GPIO_PinModeSet(SI1133_SENSOR_EN_PORT, SI1133_SENSOR_EN_PIN, gpioModePushPull, SI1133_SENSOR_DEFAULT_ASSERT_TRUE); //page 6 of lab 4 towards the top
 	GPIO_PinModeSet(SI1133_SCL_PORT, SI1133_SCL_PIN, gpioModeWiredAnd, SI1133_SCL_ASSERT_TRUE );
 	GPIO_PinModeSet(SI1133_SDA_PORT, SI1133_SDA_PIN, gpioModeWiredAnd, SI1133_SDA_ASSERT_TRUE );
+	GPIO_PinModeSet(SI1133_INT_PORT, SI1133_INT_PIN, gpioModeInputPull, true); //pulled up, the sensor pulls it low
 
 	GPIO_PinModeSet(LEUART_TX_PORT, LEUART_TX_PIN, gpioModePushPull, LEUART_TX_ASSERT_FALSE);
 	GPIO_PinModeSet(LEUART_RX_PORT, LEUART_RX_PIN, gpioModeInput, LEUART_RX_ASSERT_FALSE);
@@ -78,3 +81,63 @@ void gpio_open(void){
 
 	  GPIO_DriveStrengthSet(LEUART_TX_PORT, gpioDriveStrengthStrongAlternateWeak);
 }
+
+/***************************************************************************//**
+ * @brief
+ *  Routes a pin to its external interrupt line and posts a scheduled event on the chosen edges.
+ *
+ * @details
+ *  Line n is shared by pin n of every port, so only one port can use each pin number. Pin
+ *  interrupts are asynchronous and wake the MCU from EM2 and EM3, which is what lets a sensor
+ *  wake us instead of the LETIMER.
+ *
+ * @param[in] port
+ *  Port of the pin, already configured as an input by gpio_open()
+ *
+ * @param[in] pin
+ *  Pin number, also the interrupt line used
+ *
+ * @param[in] rising
+ *  Interrupt on the rising edge
+ *
+ * @param[in] falling
+ *  Interrupt on the falling edge
+ *
+ * @param[in] evt
+ *  Scheduled event posted on every interrupt of the line
+ ******************************************************************************/
+void gpio_int_open(GPIO_Port_TypeDef port, uint32_t pin, bool rising, bool falling, uint32_t evt) {
+  EFM_ASSERT(pin < GPIO_INT_LINES);
+  gpio_int_evt[pin] = evt;
+  GPIO_IntClear(1 << pin);
+  GPIO_ExtIntConfig(port, pin, pin, rising, falling, true);
+  if (pin & 1) NVIC_EnableIRQ(GPIO_ODD_IRQn);
+  else NVIC_EnableIRQ(GPIO_EVEN_IRQn);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Clears the interrupt lines that fired and posts their scheduled events.
+ ******************************************************************************/
+static void gpio_int_dispatch(uint32_t lines) {
+  GPIO_IntClear(lines);
+  for (uint32_t i = 0; i < GPIO_INT_LINES; i++) {
+      if (lines & (1 << i)) add_scheduled_event(gpio_int_evt[i]);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Interrupt service routine of the even numbered external interrupt lines.
+ ******************************************************************************/
+void GPIO_EVEN_IRQHandler(void) {
+  gpio_int_dispatch(GPIO_IntGetEnabled() & 0x5555);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Interrupt service routine of the odd numbered external interrupt lines.
+ ******************************************************************************/
+void GPIO_ODD_IRQHandler(void) {
+  gpio_int_dispatch(GPIO_IntGetEnabled() & 0xAAAA);
+}
@@ -14,10 +14,12 @@
 
 /* The developer's include statements */
 #include "brd_config.h"
+#include "scheduler.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
+#define GPIO_INT_LINES    16    // external interrupt lines, line n serves pin n of one port
 
 //***********************************************************************************
 // global variables
@@ -28,5 +30,8 @@
 // function prototypes
 //***********************************************************************************
 void gpio_open(void);
+void gpio_int_open(GPIO_Port_TypeDef port, uint32_t pin, bool rising, bool falling, uint32_t evt);
+void GPIO_EVEN_IRQHandler(void);
+void GPIO_ODD_IRQHandler(void);
 
 #endif
@@ -0,0 +1,120 @@
+/**
+ * @file hysteresis.c
+ * @author agent
+ * @date 10/18/2026
+ * @brief Two threshold decision with a minimum dwell time and report on change
+ *
+ */
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "hysteresis.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *  Sets up a hysteresis engine in a known state and clears its counters.
+ *
+ * @param[in] hyst
+ *  Engine to set up
+ *
+ * @param[in] falling
+ *  Value a high state has to fall below to go low
+ *
+ * @param[in] rising
+ *  Value a low state has to rise above to go high, at least falling
+ *
+ * @param[in] dwell
+ *  Time, in the unit of the now argument of hysteresis_update(), the value has to stay past the
+ *  threshold before the state follows; 0 follows at once
+ *
+ * @param[in] report_on_change
+ *  Only changes are reported when true, every update otherwise
+ *
+ * @param[in] high
+ *  Initial state
+ ******************************************************************************/
+void hysteresis_open(HYSTERESIS *hyst, uint32_t falling, uint32_t rising, uint32_t dwell, bool report_on_change, bool high) {
+  hyst->report_on_change = report_on_change;
+  hyst->high = high;
+  hyst->changes = 0;
+  hyst->suppressed = 0;
+  hysteresis_tune(hyst, falling, rising, dwell);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Changes the thresholds and the dwell time, keeping the state and the counters.
+ ******************************************************************************/
+void hysteresis_tune(HYSTERESIS *hyst, uint32_t falling, uint32_t rising, uint32_t dwell) {
+  EFM_ASSERT(falling <= rising);
+  hyst->falling = falling;
+  hyst->rising = rising;
+  hyst->dwell = dwell;
+  hyst->pending = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Feeds a value to the engine and tells whether it is to be reported.
+ *
+ * @details
+ *  A high state only goes low once the value is below falling, and a low state only goes high once
+ *  it is above rising, so noise between the two thresholds cannot toggle it. On top of that the
+ *  value has to stay past the threshold for dwell before the state follows; a value that comes back
+ *  in the mean time restarts the wait. Updates that report nothing are counted in suppressed.
+ *
+ * @param[in] hyst
+ *  Engine set up with hysteresis_open()
+ *
+ * @param[in] value
+ *  New value
+ *
+ * @param[in] now
+ *  Current time, for the dwell
+ *
+ * @return
+ *  Whether the state changed, is to be reported unchanged or nothing is to be reported
+ ******************************************************************************/
+HYSTERESIS_RESULT hysteresis_update(HYSTERESIS *hyst, uint32_t value, uint32_t now) {
+  bool past = hyst->high ? (value < hyst->falling) : (value > hyst->rising);
+
+  if (!past) {
+      hyst->pending = false;
+  }
+  else {
+      if (!hyst->pending) {
+          hyst->pending = true;
+          hyst->pending_since = now;
+      }
+      if (now - hyst->pending_since >= hyst->dwell) {
+          hyst->high = !hyst->high;
+          hyst->pending = false;
+          hyst->changes++;
+          return HYSTERESIS_CHANGED;
+      }
+  }
+  if (hyst->report_on_change || hyst->pending) {
+      hyst->suppressed++;
+      return HYSTERESIS_SUPPRESS;
+  }
+  return HYSTERESIS_REPORT;
+}
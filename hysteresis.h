@@ -0,0 +1,53 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef HYSTERESIS_HG
+#define HYSTERESIS_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+typedef enum {
+  HYSTERESIS_SUPPRESS, //nothing to report: no change in report on change mode, or a change still dwelling
+  HYSTERESIS_REPORT, //same state, reported since report on change is off
+  HYSTERESIS_CHANGED //the state has just changed
+} HYSTERESIS_RESULT;
+
+typedef struct {
+  uint32_t falling; //a high state goes low below this
+  uint32_t rising; //a low state goes high above this
+  uint32_t dwell; //time the value has to stay past a threshold before the state follows
+  bool report_on_change; //only changes are reported
+  bool high; //current state
+  bool pending; //the value is past the threshold of the other state, dwelling
+  uint32_t pending_since;
+  uint32_t changes;
+  uint32_t suppressed; //updates that reported nothing
+} HYSTERESIS;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void hysteresis_open(HYSTERESIS *hyst, uint32_t falling, uint32_t rising, uint32_t dwell, bool report_on_change, bool high);
+void hysteresis_tune(HYSTERESIS *hyst, uint32_t falling, uint32_t rising, uint32_t dwell);
+HYSTERESIS_RESULT hysteresis_update(HYSTERESIS *hyst, uint32_t value, uint32_t now);
+
+#endif
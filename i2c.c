@@ -14,12 +14,37 @@ static void i2c_bus_reset(I2C_TypeDef *i2c);
 static void i2c_ack_sm(I2C_STATE_MACHINE *i2c_sm);
 static void i2c_msstop_sm(I2C_STATE_MACHINE *i2c_sm);
 static void i2c_receive_sm(I2C_STATE_MACHINE *i2c_sm);
+static void i2c_transaction_start(I2C_STATE_MACHINE *sm, I2C_TRANSACTION *transaction);
+static void i2c_write_next(I2C_STATE_MACHINE *i2c_sm);
+static void i2c_ldma_read_start(I2C_STATE_MACHINE *i2c_sm);
+static void i2c_ldma_write_start(I2C_STATE_MACHINE *i2c_sm);
+static const I2C_INSTANCE *i2c_instance_get(I2C_TypeDef *i2c);
+static I2C_STATE_MACHINE *i2c_sm_get(I2C_TypeDef *i2c);
+static void i2c_irq(const I2C_INSTANCE *inst);
+static void i2c_attempt_start(I2C_STATE_MACHINE *sm);
+static void i2c_complete(I2C_STATE_MACHINE *i2c_sm, I2C_STATUS status);
+static void i2c_error(I2C_STATE_MACHINE *i2c_sm, I2C_STATUS status);
+static void i2c_recover(I2C_STATE_MACHINE *sm);
+static void i2c_deadline_arm(void);
+static void i2c_trigger_arm(I2C_STATE_MACHINE *sm);
+static void i2c_trigger_disarm(I2C_STATE_MACHINE *sm);
+static uint32_t i2c_event_slot(uint32_t callback);
 
 //***********************************************************************************
 // Private/Static Variables
 //***********************************************************************************
 static I2C_STATE_MACHINE i2c_state_machine_vals_I2C0;
 static I2C_STATE_MACHINE i2c_state_machine_vals_I2C1;
+static uint32_t i2c_service_evt; //posted through the RTCC when the nearest timeout or retry is due
+static volatile I2C_STATUS i2c_event_status[I2C_EVENT_SLOTS]; //status behind each callback event, by event bit
+
+static const I2C_INSTANCE i2c_instances[] = {
+    { I2C0, &i2c_state_machine_vals_I2C0, cmuClock_I2C0, I2C0_IRQn, I2C_EM_BLOCK,
+      LDMA_CH_I2C0, ldmaPeripheralSignal_I2C0_RXDATAV, ldmaPeripheralSignal_I2C0_TXBL, LDMA_CH_I2C0_TRIG },
+    { I2C1, &i2c_state_machine_vals_I2C1, cmuClock_I2C1, I2C1_IRQn, I2C_EM_BLOCK,
+      LDMA_CH_I2C1, ldmaPeripheralSignal_I2C1_RXDATAV, ldmaPeripheralSignal_I2C1_TXBL, LDMA_CH_I2C1_TRIG },
+};
+#define I2C_INSTANCES (sizeof(i2c_instances) / sizeof(i2c_instances[0]))
 
 //static I2C_STATE_MACHINE *sm;
 
@@ -33,7 +58,8 @@ static I2C_STATE_MACHINE i2c_state_machine_vals_I2C1;
  *   interrupts have been disabled using the IEN and IF register.
  *
  * @note
- *
+ *   Also used to recover from a failed transaction, so the wait for MSTOP is bounded by I2C_RESET_SPIN polls; a bus
+ *   held low by a device cannot hang the caller and the retry that follows simply fails again.
  *
  * @param[in] i2c
  *   Pointer to the base peripheral address of the I2C peripheral being opened
@@ -41,13 +67,14 @@ static I2C_STATE_MACHINE i2c_state_machine_vals_I2C1;
  ******************************************************************************/
 void i2c_bus_reset(I2C_TypeDef *i2c) {
   uint32_t ien_save_state;
+  uint32_t spin = I2C_RESET_SPIN;
   i2c ->CMD = I2C_CMD_ABORT;
   ien_save_state = i2c->IEN;
   i2c->IEN = false;
   i2c->IFC = i2c->IF;
   i2c -> CMD = I2C_CMD_CLEARTX;
   i2c->CMD = I2C_CMD_START | I2C_CMD_STOP;
-  while(!(i2c->IF & I2C_IF_MSTOP));
+  while(!(i2c->IF & I2C_IF_MSTOP) && --spin);
   i2c->IFC = i2c->IF;
   i2c ->CMD = I2C_CMD_ABORT;
   i2c ->IEN = ien_save_state;
@@ -58,11 +85,14 @@ void i2c_bus_reset(I2C_TypeDef *i2c) {
  *  This is the I2C driver function that initializes I2C0 or I2C1
  *
  * @details
- *   The open function sets up the clock for both I2C0 and I2C1, depending on which one is chosen. The I2C_Init() values are also set in
+ *   The open function sets up the clock for both I2C0 and I2C1, depending on which one is chosen, from the
+ *   i2c_instances[] entry of the peripheral. The I2C_Init() values are also set in
  *   this function. The function also contains all the NVIC vectors for interrupt purposes. The route location and the route pen is set.
  *
  * @note
- *    This function calls the i2c_bus_reset() with the i2c TypeDef all initialized.
+ *    This function calls the i2c_bus_reset() with the i2c TypeDef all initialized. With ldma_en set the LDMA
+ *    controller is opened as well and the data phase of transactions is moved by the channel of this peripheral.
+ *    The RTCC is opened to time the attempts and backoffs; service_cb is posted whenever one of them is due.
  *
  * @param[in] i2c
  *   Pointer to the base peripheral address of the I2C peripheral being opened
@@ -71,14 +101,17 @@ void i2c_bus_reset(I2C_TypeDef *i2c) {
  *   The values that are coming from the Si1133.c struct values
  ******************************************************************************/
 void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup) {
+  const I2C_INSTANCE *inst = i2c_instance_get(i2c);
+  I2C_STATE_MACHINE *sm = inst->sm;
 
-  if (i2c == I2C0) {
-      CMU_ClockEnable(cmuClock_I2C0, true);
-  }
+  sm->instance = inst; //linked once, every other lookup only reads the table
 
-  if (i2c == I2C1) {
-      CMU_ClockEnable(cmuClock_I2C1, true);
-  }
+  CMU_ClockEnable(sm->instance->clock, true);
+  sm->i2c_state = i2c;
+  sm->ldma_en = i2c_setup->ldma_en;
+  if (sm->ldma_en) ldma_open();
+  i2c_service_evt = i2c_setup->service_cb;
+  rtcc_open();
 
 
   if ((i2c->IF & 0x01) == 0) {
@@ -107,87 +140,129 @@ void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup) {
 
   //interrupts
   i2c->IFC |= _I2C_IFC_MASK;
+  i2c->CTRL = (i2c->CTRL & ~_I2C_CTRL_CLTO_MASK) | I2C_CTRL_CLTO_1024PCC; //a device stretching SCL this long is stuck
   i2c->IEN |= I2C_IEN_ACK | I2C_IEN_NACK | I2C_IEN_RXDATAV | I2C_IEN_MSTOP;
+  i2c->IEN |= I2C_IEN_ARBLOST | I2C_IEN_BUSERR | I2C_IEN_CLTO;
 
   //nvic enable
-  if (i2c == I2C1) { NVIC_EnableIRQ(I2C1_IRQn);}
-  else if (i2c == I2C0) {NVIC_EnableIRQ(I2C0_IRQn);}
+  NVIC_EnableIRQ(sm->instance->irq);
 
   i2c_bus_reset(i2c);
 
 }
 
 
+/***************************************************************************//**
+ * @brief
+ *  Places the next write byte of the active transaction on the bus, or moves on to the read or STOP phase.
+ *
+ * @details
+ *   Called for every ACK received while writing. Once all write bytes have been acknowledged a transaction with
+ *   bytes to read issues a repeated START with the read bit, otherwise a STOP ends it.
+ *
+ * @param[in] i2c_sm
+ *   State machine of the I2C peripheral.
+ ******************************************************************************/
+static void i2c_write_next(I2C_STATE_MACHINE *i2c_sm) {
+  if (i2c_sm->write_index < i2c_sm->active.write_len) {
+      i2c_sm->i2c_state->TXDATA = i2c_sm->write_ptr[i2c_sm->write_index++];
+      i2c_sm->curr_state = write_data;
+  }
+  else if (i2c_sm->active.read_len) {
+      i2c_sm->i2c_state->CMD = I2C_CMD_START;
+      i2c_sm->i2c_state->TXDATA = (i2c_sm->active.dev_address) << 1 | READ_OP; //getting ready to read from the device
+      i2c_sm->curr_state = restart_process;
+  }
+  else {
+      i2c_sm->i2c_state->CMD = I2C_CMD_STOP;
+      i2c_sm->curr_state = stop_data;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Hands the read phase of the active transaction to the LDMA once the device has acknowledged its read address.
+ *
+ * @details
+ *   The descriptor list reads each byte on RXDATAV and then writes the ACK command, or NACK and STOP after the
+ *   last byte, exactly what i2c_receive_sm() does, so the CPU stays asleep in EM1 until the MSTOP interrupt.
+ *   RXDATAV is masked meanwhile so the interrupt does not race the LDMA for the receive buffer.
+ *
+ * @param[in] i2c_sm
+ *   State machine of the I2C peripheral.
+ ******************************************************************************/
+static void i2c_ldma_read_start(I2C_STATE_MACHINE *i2c_sm) {
+  I2C_TypeDef *i2c = i2c_sm->i2c_state;
+  LDMA_Descriptor_t *desc = i2c_sm->ldma_desc;
+  uint32_t n = i2c_sm->active.read_len;
+
+  for (uint32_t i = 0; i < n; i++) {
+      desc[2*i] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_P2M_BYTE(&i2c->RXDATA, &i2c_sm->active.read_buf[i], 1, 1);
+      desc[2*i].xfer.doneIfs = 0;
+      desc[2*i + 1] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_WRITE((i == n - 1) ? I2C_CMD_NACK : I2C_CMD_ACK, &i2c->CMD, 1);
+      desc[2*i + 1].wri.doneIfs = 0;
+  }
+  desc[2*n] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_SINGLE_WRITE(I2C_CMD_STOP, &i2c->CMD);
+  desc[2*n].wri.doneIfs = 0;
+
+  i2c->IEN &= ~I2C_IEN_RXDATAV;
+  i2c_sm->curr_state = stop_data;
+  ldma_start(i2c_sm->instance->ldma_ch, i2c_sm->instance->ldma_rx_signal, desc);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Puts the device address on the bus and lets the LDMA feed the write buffer of a write only transaction.
+ *
+ * @details
+ *   The master moves from byte to byte by itself while TXDATA has data, and with AUTOSE it sends the STOP
+ *   once the last byte has been acknowledged, so the ACK interrupt is masked and MSTOP is the only one taken.
+ *   The address is written before the channel is started so the LDMA cannot slip a data byte in front of it.
+ *
+ * @param[in] i2c_sm
+ *   State machine of the I2C peripheral.
+ ******************************************************************************/
+static void i2c_ldma_write_start(I2C_STATE_MACHINE *i2c_sm) {
+  I2C_TypeDef *i2c = i2c_sm->i2c_state;
+  LDMA_Descriptor_t *desc = i2c_sm->ldma_desc;
+
+  desc[0] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(i2c_sm->write_ptr, &i2c->TXDATA, i2c_sm->active.write_len);
+  desc[0].xfer.doneIfs = 0;
+
+  i2c->IEN &= ~I2C_IEN_ACK;
+  i2c->CTRL |= I2C_CTRL_AUTOSE;
+  i2c_sm->curr_state = stop_data;
+  i2c->CMD = I2C_CMD_START;
+  i2c->TXDATA = (i2c_sm->active.dev_address) << 1 | WRITE_OP;
+  ldma_start(i2c_sm->instance->ldma_ch, i2c_sm->instance->ldma_tx_signal, desc);
+}
+
 /***************************************************************************//**
  * @brief
  *  The i2c_ack_sm function deals with all the ACK interrupts the master gets from the slave.
  *
  * @details
- *   A counter is setup so that after the desired number of ACKs have been received, it goes to the next state.
- *   In this state machine, the master first transmits the dev_address (with bit shifting) to the slave. After we have
- *   an ACK from the slave, the counter increases by 1. Then the register_address is transmitted to the slave, after which we get
- *   another ACK, and the counter increases by 1. Then the master(gecko) has to send the start command again, which
- *   is the dev_address but this time OR'ed with the the READ_OP to indicate that the master is ready to start receiving data.
- *   All of the mentioned statements are happening in one state.All the other cases are asserted to false so that it never enters those.
- *   Once counter_var reaches 3, meaning we have reached the desired number of ACKs, then it will go to the next state, which is the
- *   read_data case. In this function we are also checking when the read_write_op equals 0 in case we are dealing with a write_data and in this case
- *   we will move to the write_data case where we are writing data to the Si1133.
+ *   The ACK of the device address with the write bit, and of every byte written after it, sends the next byte of
+ *   the write buffer. The register address is simply the first of those bytes. After the last one either a repeated
+ *   START with the read bit is sent or the transfer is stopped. The ACK of the address with the read bit moves to
+ *   read_data, where the RXDATAV interrupt takes over, or in LDMA mode starts the descriptor list that reads the data.
  *
  * @note
  *  For all three state machines, there exists a default case where there is an EFM_ASSERT set to false for debugging purposes, if anything goes wrong in the state machine above.
  *
  ******************************************************************************/
-uint32_t left_shift_val = 0;
-
 void i2c_ack_sm(I2C_STATE_MACHINE *i2c_sm){
   switch(i2c_sm->curr_state) {
     case init_process:
-      if (i2c_sm->counter_var == 0){
-          i2c_sm->i2c_state->TXDATA = (i2c_sm->dev_address) << 1 | WRITE_OP;
-          i2c_sm->counter_var += 1;
-          i2c_sm->curr_state = init_process;
-      }
-      else if (i2c_sm->counter_var == 1) {
-          i2c_sm->i2c_state->TXDATA = i2c_sm->register_address;
-          i2c_sm->counter_var += 1;
-
-          i2c_sm->curr_state = init_process;
-          if (i2c_sm->read_write_op == 0){
-
-              i2c_sm->curr_state = write_data;
-              i2c_sm->i2c_state->TXDATA = (*(i2c_sm->num_data)) << (left_shift_val*8);
-              i2c_sm->number_bytes -= 1;
-          }
-      }
-      else if (i2c_sm->counter_var == 2) {
-          i2c_sm->i2c_state->CMD = I2C_CMD_START;
-          i2c_sm->i2c_state->TXDATA = (i2c_sm->dev_address) << 1 | READ_OP; //getting ready to read from Si1133
-          i2c_sm->counter_var += 1;
-          i2c_sm->curr_state = init_process;
-      }
-      else if (i2c_sm->counter_var == 3) {
-          i2c_sm->curr_state = read_data;
-          //i2c_sm->curr_state =
-      }
+    case write_data:
+      i2c_write_next(i2c_sm);
+      break;
+    case restart_process:
+      if (i2c_sm->mode == I2C_MODE_LDMA) i2c_ldma_read_start(i2c_sm);
+      else i2c_sm->curr_state = read_data;
       break;
     case read_data:
     case stop_data:
-     // i2c_sm->i2c_state->CMD = I2C_CMD_STOP;
-      break;
-    case write_data:
-
-      if(i2c_sm->number_bytes > 0)
-              {
-                i2c_sm->i2c_state->TXDATA = (*(i2c_sm->num_data)) << (left_shift_val*8);
-                left_shift_val +=1;
-                i2c_sm->number_bytes -= 1;
-                i2c_sm->curr_state = write_data;
-              }
-            else if (i2c_sm-> number_bytes == 0)
-              {
-                i2c_sm->i2c_state->CMD = I2C_CMD_STOP;
-                i2c_sm->curr_state = stop_data;
-              }
       break;
     default:
       EFM_ASSERT(false);
@@ -200,12 +275,8 @@ void i2c_ack_sm(I2C_STATE_MACHINE *i2c_sm){
  *  The i2c_receive_sm function deals with all the RXDATAV interrupts the master gets from the slave.
  *
  * @details
- *   In this state machine, we are receiving data from the Si1133 sensor. It is also incorporated with a counter. This is the read_data case.
- *   After the master has received the third ACK from the Si1133, then it can start sending the the data. It is running on a receive_counter and will
- *   increment once the needed bytes have been read. number_bytes is being used
- *   to keep track of how many more bytes is there to be read/ If there is no more data to be read, the NACK will be sent from the master to slave followed by a STOP
- *   command.It will then change the current state to stop_data.
- *
+ *   Each byte received is stored in order into the read buffer of the active transaction. The last byte is
+ *   answered with a NACK followed by a STOP command and the state changes to stop_data, every other byte with an ACK.
  *
  * @note
  *  For all three state machines, there exists a default case where there is an EFM_ASSERT set to false for debugging purposes, if anything goes wrong in the state machine above.
@@ -215,33 +286,20 @@ void i2c_ack_sm(I2C_STATE_MACHINE *i2c_sm){
 void i2c_receive_sm(I2C_STATE_MACHINE *i2c_sm) {
   switch(i2c_sm->curr_state) {
     case read_data:
-      {
-
-        i2c_sm->number_bytes = i2c_sm->number_bytes - 1;
-        *(i2c_sm->num_data) &= ~(0xff << (BIT_SHIFT_EIGHT*i2c_sm->number_bytes));
-        *(i2c_sm->num_data) |= i2c_sm->i2c_state->RXDATA << (BIT_SHIFT_EIGHT*i2c_sm->number_bytes); //two byte functionality
-      //  *(i2c_sm->num_data) = i2c_sm -> i2c_state->RXDATA >> (BIT_SHIFT_EIGHT * (i2c_sm->number_bytes -1)); //one byte functionality
-       //  i2c_sm->number_bytes = i2c_sm->number_bytes - 1;
-
-
-
-        if(i2c_sm->number_bytes == 0)
-                {
-                  i2c_sm->i2c_state->CMD = I2C_CMD_NACK;
-                  i2c_sm->i2c_state->CMD = I2C_CMD_STOP;
-                  i2c_sm->curr_state = stop_data;
-                }
-        else
-          {
-              i2c_sm->i2c_state->CMD = I2C_CMD_ACK;
-              i2c_sm->curr_state = read_data;
-          }
-
-              break;
+      i2c_sm->active.read_buf[i2c_sm->read_index++] = i2c_sm->i2c_state->RXDATA;
+      if (i2c_sm->read_index == i2c_sm->active.read_len) {
+          i2c_sm->i2c_state->CMD = I2C_CMD_NACK;
+          i2c_sm->i2c_state->CMD = I2C_CMD_STOP;
+          i2c_sm->curr_state = stop_data;
       }
+      else {
+          i2c_sm->i2c_state->CMD = I2C_CMD_ACK;
+      }
+      break;
     case init_process:
-    case stop_data:
     case write_data:
+    case restart_process:
+    case stop_data:
       default:
         EFM_ASSERT(false);
         break;
@@ -256,6 +314,9 @@ void i2c_receive_sm(I2C_STATE_MACHINE *i2c_sm) {
  *   In this state machine, the Si1133 has sent all the data we needed and the master sends a NACK
  *   back to the Si1133 to signal the end of transmission. Then the master sends a STOP command which returns back to
  *   the master which is the MSTOP interrupt. It will unblock the energy mode EM2. All the other cases are set to default so they are not used.
+ *   If more transactions are waiting in the queue, the next one is started right here so the bus runs back to back
+ *   without going through the main loop. The interrupts the transaction took are added to the statistics of its mode.
+ *   An MSTOP outside of stop_data is the tail of an aborted attempt and is ignored.
  *
  * @note
  *  For all three state machines, there exists a default case where there is an EFM_ASSERT set to false for debugging purposes.
@@ -264,13 +325,16 @@ void i2c_receive_sm(I2C_STATE_MACHINE *i2c_sm) {
 void i2c_msstop_sm(I2C_STATE_MACHINE *i2c_sm) {
   switch(i2c_sm->curr_state) {
     case stop_data:
-      sleep_unblock_mode(I2C_EM_BLOCK);
-       i2c_sm->not_available = false;
-       add_scheduled_event(i2c_sm->callback_i2c);
+      i2c_sm->stats[i2c_sm->mode].transactions++;
+      i2c_sm->stats[i2c_sm->mode].interrupts += i2c_sm->irq_count;
+      i2c_sm->stats[i2c_sm->mode].bytes += i2c_sm->active.write_len + i2c_sm->active.read_len;
+      i2c_complete(i2c_sm, I2C_STATUS_OK);
        break;
     case init_process:
-    case read_data:
     case write_data:
+    case restart_process:
+    case read_data:
+          break;
         default:
           EFM_ASSERT(false);
           break;
@@ -279,145 +343,639 @@ void i2c_msstop_sm(I2C_STATE_MACHINE *i2c_sm) {
 
 /***************************************************************************//**
  * @brief
- * The void I2C0_IRQHandler function sets/develops the Interrupt Service Routine for I2C0
+ *  Completes the active transaction with a status and starts the next queued one.
+ *
+ * @details
+ *  The status is kept with the callback event, for i2c_status_get(), before the event is posted,
+ *  so the callback can tell a good read from a failed one whatever completed on the bus since. The
+ *  callback is posted either way: every submitted transaction ends in exactly one callback.
+ *
+ * @param[in] i2c_sm
+ *   State machine of the I2C peripheral.
+ *
+ * @param[in] status
+ *   Outcome of the transaction.
+ ******************************************************************************/
+static void i2c_complete(I2C_STATE_MACHINE *i2c_sm, I2C_STATUS status) {
+  uint32_t latency = rtcc_time_get() - i2c_sm->active.submit_time;
+
+  if (i2c_sm->mode == I2C_MODE_LDMA) {
+      i2c_sm->i2c_state->CTRL &= ~I2C_CTRL_AUTOSE;
+      i2c_sm->i2c_state->IFC = I2C_IF_ACK | I2C_IF_RXDATAV; //flags raised while masked must not reach the next transaction
+      i2c_sm->i2c_state->IEN |= I2C_IEN_ACK | I2C_IEN_RXDATAV;
+  }
+  if (latency > i2c_sm->latency_max) i2c_sm->latency_max = latency;
+  if (status != I2C_STATUS_OK) i2c_sm->failures++;
+  i2c_sm->curr_state = stop_data;
+  sleep_unblock_mode(i2c_sm->instance->sleep_block);
+  i2c_event_post(i2c_sm->active.callback_i2c, status);
+  if (i2c_sm->queue_count) {
+      I2C_TRANSACTION *next = &i2c_sm->queue[i2c_sm->queue_head];
+      i2c_sm->queue_head = (i2c_sm->queue_head + 1) % I2C_QUEUE_DEPTH;
+      i2c_sm->queue_count--;
+      i2c_transaction_start(i2c_sm, next);
+  }
+  else {
+      i2c_sm->not_available = false;
+      if (i2c_sm->trigger_wanted) i2c_trigger_arm(i2c_sm); //the bus is free again until the next transfer
+      i2c_deadline_arm();
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Abandons the current attempt of the active transaction after a bus error or a timeout.
+ *
+ * @details
+ *   Called from the interrupt handler, so it only does what cannot wait: the LDMA channel is
+ *   stopped, the peripheral aborts and its interrupts are masked. The bus reset, which polls for
+ *   MSTOP, is left to i2c_recover() through the service event, outside any interrupt.
+ *
+ * @param[in] i2c_sm
+ *   State machine of the I2C peripheral.
+ *
+ * @param[in] status
+ *   Cause of the failure.
+ ******************************************************************************/
+static void i2c_error(I2C_STATE_MACHINE *i2c_sm, I2C_STATUS status) {
+  if (!i2c_sm->not_available || i2c_sm->retry_pending || i2c_sm->reset_pending) return; //nothing of ours on the bus
+  if (i2c_sm->mode == I2C_MODE_LDMA) ldma_stop(i2c_sm->instance->ldma_ch);
+  i2c_sm->i2c_state->CMD = I2C_CMD_ABORT;
+  i2c_sm->error_ien = i2c_sm->i2c_state->IEN;
+  i2c_sm->i2c_state->IEN = 0;
+  i2c_sm->i2c_state->IFC = _I2C_IFC_MASK;
+  i2c_sm->error_status = status;
+  i2c_sm->reset_pending = true;
+  add_scheduled_event(i2c_service_evt);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Resets the bus after a failed attempt and retries or fails the active transaction.
+ *
+ * @details
+ *   Runs from i2c_service(), with interrupts enabled while the bus reset polls. The transaction
+ *   either waits out a backoff of I2C_BACKOFF_TICKS, doubled on every retry, or after I2C_ATTEMPTS
+ *   attempts is completed with the error status. EM2 is released during the backoff since nothing
+ *   is on the bus; the RTCC brings i2c_service() back when the retry is due.
+ *
+ * @param[in] sm
+ *   State machine of the I2C peripheral.
+ ******************************************************************************/
+static void i2c_recover(I2C_STATE_MACHINE *sm) {
+  i2c_bus_reset(sm->i2c_state);
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  sm->i2c_state->IEN = sm->error_ien;
+  sm->reset_pending = false;
+  sm->errors[sm->error_status]++;
+  sm->attempt++;
+  if (sm->attempt >= I2C_ATTEMPTS) {
+      i2c_complete(sm, sm->error_status);
+  }
+  else {
+      if (sm->mode == I2C_MODE_LDMA) {
+          sm->i2c_state->CTRL &= ~I2C_CTRL_AUTOSE;
+          sm->i2c_state->IEN |= I2C_IEN_ACK | I2C_IEN_RXDATAV;
+      }
+      sm->curr_state = stop_data;
+      sm->retry_pending = true;
+      sm->retry_time = rtcc_time_get() + (I2C_BACKOFF_TICKS << (sm->attempt - 1));
+      sleep_unblock_mode(sm->instance->sleep_block);
+  }
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Arms the RTCC for the nearest attempt timeout or retry of both I2C peripherals, or stops it.
+ *
+ * @details
+ *  Called with interrupts disabled whenever a deadline may have moved: an attempt started, a
+ *  transaction completed with nothing behind it, and at the end of i2c_service(). A deadline
+ *  already past is armed RTCC_MIN_TICKS out.
+ ******************************************************************************/
+static void i2c_deadline_arm(void) {
+  uint32_t now = rtcc_time_get();
+  uint32_t wait = 0;
+  bool armed = false;
+
+  for (uint32_t i = 0; i < I2C_INSTANCES; i++) {
+      I2C_STATE_MACHINE *sm = i2c_instances[i].sm;
+      if (!sm->not_available || sm->reset_pending) continue;
+      uint32_t deadline = sm->retry_pending ? sm->retry_time : sm->attempt_time + I2C_TIMEOUT_TICKS;
+      int32_t left = (int32_t)(deadline - now);
+      if (left < 0) left = 0;
+      if (!armed || (uint32_t)left < wait) wait = left;
+      armed = true;
+  }
+  if (armed) rtcc_event(RTCC_CH_I2C, wait, i2c_service_evt);
+  else rtcc_event_cancel(RTCC_CH_I2C);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Interrupt service routine body shared by I2C0 and I2C1
  *
  * @details
  * if statements to check which interrupt it was and calls the appropriate state machines functions.
  * If it's the ACK interrupt, it goes to the i2c_ack_sm(). If it's the RXDATA interrupt, it goes to the
- * i2c_receive_sm(). If it's the MSTOP interrupt, it goes to the i2c_msstop_sm().
+ * i2c_receive_sm(). If it's the MSTOP interrupt, it goes to the i2c_msstop_sm(). A NACK, arbitration loss,
+ * bus error or clock low timeout abandons the attempt through i2c_error() before anything else is looked at.
  *
  * @note
+ *  Everything specific to a peripheral comes from its i2c_instances[] entry, so both buses run their own
+ *  transactions at the same time through the same code.
  *
+ * @param[in] inst
+ *  Instance whose interrupt fired
  ******************************************************************************/
+static void i2c_irq(const I2C_INSTANCE *inst) {
+  I2C_STATE_MACHINE *sm = inst->sm;
+  uint32_t int_flag = inst->regs->IF & inst->regs->IEN;
 
-void I2C0_IRQHandler(void) {
-
-  uint32_t int_flag = I2C0->IF & I2C0->IEN;
-  I2C0->IFC = int_flag;
+  inst->regs->IFC = int_flag;
+  sm->irq_count++;
+  if (int_flag & I2C_ERROR_IRQS)
+    {
+      i2c_error(sm, (int_flag & I2C_IF_NACK) ? I2C_STATUS_NACK :
+                (int_flag & I2C_IF_ARBLOST) ? I2C_STATUS_ARBLOST :
+                (int_flag & I2C_IF_BUSERR) ? I2C_STATUS_BUSERR : I2C_STATUS_TIMEOUT);
+      return;
+    }
   if (int_flag & I2C_IF_ACK)
     {
-      //need to include the parameter for the I2C0 state machine
-      i2c_ack_sm(&i2c_state_machine_vals_I2C0);
+      i2c_ack_sm(sm);
     }
-  //Don't need this for NACK
 
   if (int_flag & I2C_IF_RXDATAV)
     {
-      //need to include the parameter for the I2C0 state machine
-      i2c_receive_sm(&i2c_state_machine_vals_I2C0);
-  }
+      i2c_receive_sm(sm);
+    }
 
   if (int_flag & I2C_IF_MSTOP)
     {
-      //need to include the parameter for the I2C0 state machine
-      i2c_msstop_sm(&i2c_state_machine_vals_I2C0);
+      i2c_msstop_sm(sm);
     }
+}
 
+/***************************************************************************//**
+ * @brief
+ * The void I2C0_IRQHandler function sets/develops the Interrupt Service Routine for I2C0
+ ******************************************************************************/
+void I2C0_IRQHandler(void) {
+  i2c_irq(&i2c_instances[0]);
 }
 
 /***************************************************************************//**
  * @brief
  * The void I2C1_IRQHandler function sets/develops the Interrupt Service Routine for I2C1
+ ******************************************************************************/
+void I2C1_IRQHandler(void){
+  i2c_irq(&i2c_instances[1]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Loads a transaction into the state machine and puts the START and device address on the bus.
  *
  * @details
- * if statements to check which interrupt it was and calls the appropritate state machines functions.
- * If it's the ACK interrupt, it goes to the i2c_ack_sm(). If it's the RXDATA interrupt, it goes to the
- * i2c_receive_sm(). If it's the MSTOP interrupt, it goes to the i2c_msstop_sm().
+ *  The transaction is copied, so a queue slot is free again as soon as it has been started. A transaction
+ *  without write bytes goes straight to the read phase with the read bit set in the address. In LDMA mode a
+ *  write only transaction is handed to the LDMA here; a read keeps its short register write on interrupts and
+ *  hands over the read phase after the repeated START.
  *
  * @note
+ *  Called from i2c_transfer() for an idle bus and from the MSTOP interrupt to chain the next queued transaction.
  *
+ * @param[in] sm
+ *  State machine of the I2C peripheral.
+ *
+ * @param[in] transaction
+ *  The transaction to start.
  ******************************************************************************/
+void i2c_transaction_start(I2C_STATE_MACHINE *sm, I2C_TRANSACTION *transaction) {
+  sm->active = *transaction;
+  sm->attempt = 0;
+  i2c_attempt_start(sm);
+  i2c_deadline_arm();
+}
 
-void I2C1_IRQHandler(void){
+/***************************************************************************//**
+ * @brief
+ *  Puts the active transaction on the bus, first attempt or retry.
+ ******************************************************************************/
+static void i2c_attempt_start(I2C_STATE_MACHINE *sm) {
+  sm->attempt_time = rtcc_time_get();
+  sm->write_ptr = sm->active.write_ext ? sm->active.write_ext : sm->active.write_inline;
+  sm->write_index = 0;
+  sm->read_index = 0;
+  sm->irq_count = 0;
+  sm->mode = (sm->ldma_en && sm->active.read_len <= I2C_LDMA_MAX_READ) ? I2C_MODE_LDMA : I2C_MODE_IRQ;
+  if (sm->mode == I2C_MODE_LDMA && !sm->active.read_len) {
+      i2c_ldma_write_start(sm);
+      return;
+  }
+  sm->i2c_state->CMD = I2C_CMD_START;
+  if (sm->active.write_len) {
+      sm->curr_state = init_process;
+      sm->i2c_state->TXDATA = (sm->active.dev_address) << 1 | WRITE_OP;
+  }
+  else {
+      sm->curr_state = restart_process;
+      sm->i2c_state->TXDATA = (sm->active.dev_address) << 1 | READ_OP;
+  }
+}
 
-  uint32_t int_flag = I2C1->IF & I2C1->IEN;
-    I2C1->IFC = int_flag;
-    if (int_flag & I2C_IF_ACK)
-      {
-        //need to include the parameter for the I2C1 state machine
-              i2c_ack_sm(&i2c_state_machine_vals_I2C1);
-      }
+/***************************************************************************//**
+ * @brief
+ *  Submits an I2C transfer: write_len bytes, then optionally a repeated START and read_len bytes.
+ *  Starts it right away if the bus is idle, otherwise queues it behind the active one.
+ *  The callback is posted when the transfer completes, successfully or not; i2c_status_get() tells which.
+ *  A transfer that finds the queue full is refused and its callback is never posted; the caller may post
+ *  it with i2c_event_post() and I2C_STATUS_REFUSED.
+ *
+ * @details
+ *   This is the one entry point of the driver for any device. A register read is a one byte write of the register
+ *   address followed by the read, a register write is the register address followed by the data, all in one
+ *   write buffer. Writes of up to I2C_WRITE_INLINE bytes are copied into the transaction so the caller may reuse
+ *   its buffer as soon as the function returns; longer write buffers and the read buffer must stay valid until the
+ *   callback event has been scheduled. The function never waits on the bus; queued transfers are started by the
+ *   MSTOP interrupt of the one before them.
+ *
+ * @note
+ *  Energy mode EM2 is blocked once per accepted transfer and released as each one completes.
+ *
+ * @param[in] i2c
+ *  Pointer to the base peripheral address of the I2C peripheral
+ *
+ * @param[in] device_add
+ *  The 7 bit address of the slave device
+ *
+ * @param[in] write_buf
+ *  Bytes written after the device address, register address first
+ *
+ * @param[in] write_len
+ *  Number of bytes in write_buf
+ *
+ * @param[out] read_buf
+ *  Destination of the bytes read, in the order they arrive on the bus
+ *
+ * @param[in] read_len
+ *  Number of bytes to read, 0 for a write only transfer
+ *
+ * @param[in] callback
+ *  Scheduled event posted once the STOP condition has gone out
+ *
+ * @return
+ *  true if the transfer was started or queued, false if I2C_QUEUE_DEPTH transfers were already waiting
+ ******************************************************************************/
 
-    //Don't need one for NACK
+bool i2c_transfer(I2C_TypeDef *i2c, uint32_t device_add, const uint8_t *write_buf, uint32_t write_len, uint8_t *read_buf, uint32_t read_len, uint32_t callback)
+{
+  I2C_STATE_MACHINE *sm = i2c_sm_get(i2c);
+  I2C_TRANSACTION transaction;
 
-    if (int_flag & I2C_IF_RXDATAV)
-      {
-        //need to include the parameter for the I2C1 state machine
-              i2c_receive_sm(&i2c_state_machine_vals_I2C1);
-    }
+  EFM_ASSERT(write_len || read_len);
+  EFM_ASSERT(!read_len || read_buf);
 
-    if (int_flag & I2C_IF_MSTOP)
-      {
-        //need to include the parameter for the I2C1 state machine
-                      i2c_msstop_sm(&i2c_state_machine_vals_I2C1);
-                      //i2c_receive_sm(&i2c_state_machine_vals_I2C1);
+  transaction.dev_address = device_add;
+  transaction.write_len = write_len;
+  if (write_len <= I2C_WRITE_INLINE) {
+      for (uint32_t i = 0; i < write_len; i++) transaction.write_inline[i] = write_buf[i];
+      transaction.write_ext = NULL;
+  }
+  else {
+      transaction.write_ext = write_buf;
+  }
+  transaction.read_buf = read_buf;
+  transaction.read_len = read_len;
+  transaction.callback_i2c = callback;
+  transaction.submit_time = rtcc_time_get();
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  if (sm->not_available && sm->queue_count >= I2C_QUEUE_DEPTH) {
+      sm->refused++;
+      CORE_EXIT_CRITICAL();
+      return false;
+  }
+  sleep_block_mode(sm->instance->sleep_block);
+  if (!sm->not_available) {
+      sm->not_available = true; //should be true in block mode, busy is true here
+      if (sm->trigger_armed) {
+          //claimed first, so a transfer from an interrupt while the triggered write is waited out is queued
+          CORE_EXIT_CRITICAL();
+          i2c_trigger_disarm(sm);
+          CORE_ENTER_CRITICAL();
       }
-
+      EFM_ASSERT((i2c->STATE & _I2C_STATE_STATE_MASK) == I2C_STATE_STATE_IDLE);
+      sm->i2c_state = i2c;
+      i2c_transaction_start(sm, &transaction);
+  }
+  else {
+      sm->queue[(sm->queue_head + sm->queue_count) % I2C_QUEUE_DEPTH] = transaction;
+      sm->queue_count++;
+  }
+  CORE_EXIT_CRITICAL();
+  return true;
 }
 
 /***************************************************************************//**
  * @brief
- *  Initializes a private STRUCT that will keep track of what operation I2C is in. Initiates the transfer of data by initializing everything
+ *  Replays a short write on every rising edge of a PRS channel, with no interrupt and no CPU.
  *
  * @details
- *   Need to make sure what peripheral we are choosing by including the if statements. The input arguments to this function will initialize the
- *   local struct
+ *  The PRS edge sets the LDMA SYNC bit of the same number. A descriptor loop on the trigger channel
+ *  of the peripheral waits for that bit, clears it, writes START and the device address and moves
+ *  write_buf to TXDATA on TXBL; AUTOSE sends the STOP and AUTOSN gives up on a NACK. While armed the
+ *  interrupts of the peripheral are masked, so nothing wakes the CPU for the write.
+ *
+ *  The loop owns the bus only while no transaction is active or queued: i2c_transfer() disarms it
+ *  first, waiting out a write already on the bus, and the last transaction to complete arms it
+ *  again. An edge that comes while disarmed stays in the SYNC bit and is written once armed, late
+ *  rather than lost.
  *
  * @note
+ *  The LDMA runs on the HF clock, so EM2 is blocked while armed. The CPU sleeps but the
+ *  MCU stays in EM1 between triggers.
  *
+ * @param[in] device_add
+ *  The 7 bit address of the slave device
  *
- * @param[in] i2c
- * Pointer to the base peripheral address of the I2C peripheral being opened
- *
- *@param[in] device_add
- *  The device address that will be passed onto the STRUCT (slave address)
- * @param[in] register_add
- *  Register address that's being passed onto our STRUCT
- *  @param[in] read_write
- *  The operation, READ or WRITE, Read Operation is 1, Write Operation is 0
- *  @param[in] callback
- *  calback that will be passed onto our struct
- *  @param[in] data
- *  The data being received
- *  @param[in]  number_bytes
- *  The number of bytes we get from the slave.
- ******************************************************************************/
-
-void i2c_start(I2C_TypeDef *i2c, uint32_t device_add, uint32_t register_add, uint32_t read_write, uint32_t callback, uint32_t *data, uint32_t number_bytes)
-{
-  static I2C_STATE_MACHINE *sm;
-  if(i2c == I2C0) {
-      sm = &i2c_state_machine_vals_I2C0;
-  }
-  else if (i2c == I2C1) {
-      sm = &i2c_state_machine_vals_I2C1;
+ * @param[in] write_buf
+ *  Bytes written after the device address, copied
+ *
+ * @param[in] write_len
+ *  Number of bytes in write_buf, 1 to I2C_TRIGGER_MAX_WRITE
+ *
+ * @param[in] prs_ch
+ *  PRS channel whose rising edge triggers the write, 0 to 7
+ ******************************************************************************/
+void i2c_trigger_write_open(I2C_TypeDef *i2c, uint32_t device_add, const uint8_t *write_buf, uint32_t write_len, uint32_t prs_ch) {
+  I2C_STATE_MACHINE *sm = i2c_sm_get(i2c);
+  LDMA_Descriptor_t *desc = sm->trigger_desc;
+  uint32_t sync = 1UL << prs_ch;
+
+  EFM_ASSERT(write_len && write_len <= I2C_TRIGGER_MAX_WRITE && !sm->trigger_wanted);
+  for (uint32_t i = 0; i < write_len; i++) sm->trigger_buf[i] = write_buf[i];
+  sm->trigger_prs_ch = prs_ch;
+
+  desc[0] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_SYNC(0, 0, sync, sync, 1);
+  desc[1] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_SYNC(0, sync, 0, 0, 1);
+  desc[2] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_WRITE(I2C_CMD_START, &i2c->CMD, 1);
+  desc[3] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_WRITE(device_add << 1 | WRITE_OP, &i2c->TXDATA, 1);
+  desc[4] = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_LINKREL_M2P_BYTE(sm->trigger_buf, &i2c->TXDATA, write_len, -4);
+  desc[0].sync.doneIfs = 0;
+  desc[1].sync.doneIfs = 0;
+  desc[2].wri.doneIfs = 0;
+  desc[3].wri.doneIfs = 0;
+  desc[4].xfer.doneIfs = 0;
+
+  ldma_open();
+  ldma_sync_clear(sync);
+  ldma_sync_prs_enable(prs_ch, true);
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  sm->trigger_wanted = true;
+  if (!sm->not_available) i2c_trigger_arm(sm);
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Hands the free bus to the trigger loop of i2c_trigger_write_open().
+ ******************************************************************************/
+static void i2c_trigger_arm(I2C_STATE_MACHINE *sm) {
+  I2C_TypeDef *i2c = sm->i2c_state;
+
+  sm->trigger_ien = i2c->IEN;
+  i2c->IEN = 0;
+  i2c->CTRL |= I2C_CTRL_AUTOSE | I2C_CTRL_AUTOSN;
+  sleep_block_mode(sm->instance->sleep_block);
+  ldma_start(sm->instance->trigger_ch, sm->instance->ldma_tx_signal, sm->trigger_desc);
+  sm->trigger_armed = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Takes the bus back from the trigger loop before a transaction of the CPU.
+ *
+ * @details
+ *  A triggered write already on the bus is a few bytes long and is waited out, bounded by
+ *  I2C_RESET_SPIN polls; a bus that does not go idle in that time is reset. Called with interrupts
+ *  enabled, once i2c_transfer() has claimed the bus. The flags the
+ *  triggered writes raised while masked are cleared so they do not reach the transaction.
+ ******************************************************************************/
+static void i2c_trigger_disarm(I2C_STATE_MACHINE *sm) {
+  I2C_TypeDef *i2c = sm->i2c_state;
+  uint32_t spin = I2C_RESET_SPIN;
+
+  ldma_stop(sm->instance->trigger_ch);
+  while ((i2c->STATE & _I2C_STATE_STATE_MASK) != I2C_STATE_STATE_IDLE && --spin);
+  if (!spin) i2c_bus_reset(i2c);
+  i2c->CTRL &= ~(I2C_CTRL_AUTOSE | I2C_CTRL_AUTOSN);
+  i2c->IFC = _I2C_IFC_MASK;
+  i2c->IEN = sm->trigger_ien;
+  sleep_unblock_mode(sm->instance->sleep_block);
+  sm->trigger_armed = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns true while an I2C peripheral has a transaction active, waiting out a backoff or queued.
+ *
+ * @details
+ *  Only reads the state: timeouts, retries and bus resets are left to the RTCC event of i2c_service().
+ ******************************************************************************/
+bool i2c_busy(I2C_TypeDef *i2c) {
+  return i2c_sm_get(i2c)->not_available;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns the entry of the instance table of an I2C peripheral.
+ ******************************************************************************/
+static const I2C_INSTANCE *i2c_instance_get(I2C_TypeDef *i2c) {
+  for (uint32_t i = 0; i < I2C_INSTANCES; i++) {
+      if (i2c_instances[i].regs == i2c) return &i2c_instances[i];
   }
-  else {
-      EFM_ASSERT(false);
+  EFM_ASSERT(false);
+  return &i2c_instances[0];
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns the state machine of an I2C peripheral, which i2c_open() has linked to its instance.
+ ******************************************************************************/
+static I2C_STATE_MACHINE *i2c_sm_get(I2C_TypeDef *i2c) {
+  I2C_STATE_MACHINE *sm = i2c_instance_get(i2c)->sm;
+
+  EFM_ASSERT(sm->instance != NULL); //the peripheral has not been opened
+  return sm;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Switches the data phase of an I2C peripheral between the LDMA and one interrupt per byte.
+ *
+ * @details
+ *  Takes effect from the next transaction started, so it can be flipped at run time to compare
+ *  both modes on the same traffic with i2c_stats_get().
+ ******************************************************************************/
+void i2c_ldma_enable(I2C_TypeDef *i2c, bool enable) {
+  I2C_STATE_MACHINE *sm = i2c_sm_get(i2c);
+
+  if (enable) ldma_open();
+  sm->ldma_en = enable;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Copies the transaction, interrupt and byte counts of each mode of an I2C peripheral.
+ *
+ * @param[out] stats
+ *  Array of I2C_MODES entries, indexed by I2C_MODE
+ ******************************************************************************/
+void i2c_stats_get(I2C_TypeDef *i2c, I2C_STATS *stats) {
+  I2C_STATE_MACHINE *sm = i2c_sm_get(i2c);
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  for (uint32_t i = 0; i < I2C_MODES; i++) stats[i] = sm->stats[i];
+  CORE_EXIT_CRITICAL();
+}
+
+
+
+
+
+/***************************************************************************//**
+ * @brief
+ *  Enforces the attempt timeout and starts retries whose backoff has run out, on both I2C peripherals.
+ *
+ * @details
+ *  The hardware catches a NACK, a lost arbitration, a bus error and SCL held low on its own. This
+ *  catches everything else, such as a device that stops answering in the middle of a read, by
+ *  comparing the RTCC time against the start of the attempt, and resets the bus after a failure
+ *  the interrupt handler left to it. The service event passed to i2c_open() must call it: the RTCC
+ *  posts that event at the nearest deadline, so timeouts and backoffs keep their own time whatever
+ *  the LETIMER period, and go on while LETIMER0 is stopped after a burst.
+ ******************************************************************************/
+void i2c_service(void) {
+  CORE_DECLARE_IRQ_STATE;
+
+  for (uint32_t i = 0; i < I2C_INSTANCES; i++) {
+      I2C_STATE_MACHINE *sm = i2c_instances[i].sm;
+      CORE_ENTER_CRITICAL();
+      uint32_t now = rtcc_time_get();
+      if (sm->not_available && sm->retry_pending) {
+          if ((int32_t)(now - sm->retry_time) >= 0) {
+              sm->retry_pending = false;
+              sleep_block_mode(sm->instance->sleep_block);
+              i2c_attempt_start(sm);
+          }
+      }
+      else if (sm->not_available && !sm->reset_pending && now - sm->attempt_time >= I2C_TIMEOUT_TICKS) {
+          i2c_error(sm, I2C_STATUS_TIMEOUT);
+      }
+      CORE_EXIT_CRITICAL();
+      if (sm->reset_pending) i2c_recover(sm);
   }
-  while(sm->not_available);
-  EFM_ASSERT((sm->curr_state & _I2C_STATE_STATE_MASK) == I2C_STATE_STATE_IDLE); // X = the I2C peripheral #
-  sleep_block_mode(I2C_EM_BLOCK);
+  CORE_ENTER_CRITICAL();
+  i2c_deadline_arm();
+  CORE_EXIT_CRITICAL();
+}
 
-  sm->i2c_state = i2c;
-  sm->not_available = true; //should be true in block mode, busy is true here
-  sm->curr_state = init_process;
-  sm->dev_address = device_add;
-  sm->register_address = register_add;
-  sm->read_write_op = read_write;
-  sm->num_data = data;
-  sm->number_bytes = number_bytes;
-  sm->callback_i2c = callback;
-  sm->counter_var = 1;
-  sm->receive_counter = 0;
-  i2c->CMD = I2C_CMD_START;
-  sm->i2c_state->TXDATA = (sm->dev_address) << 1 | WRITE_OP;
+/***************************************************************************//**
+ * @brief
+ *  Returns the status of the last transaction that posted a callback event.
+ *
+ * @details
+ *  Each scheduler event bit has its own slot, written right before the event is posted, so
+ *  transactions completed on either bus with other callbacks in the mean time, NULL_CB ones
+ *  included, do not change what the callback reads.
+ *
+ * @param[in] callback
+ *  The callback event the transaction was submitted with, a single bit
+ ******************************************************************************/
+I2C_STATUS i2c_status_get(uint32_t callback) {
+  return i2c_event_status[i2c_event_slot(callback)];
 }
 
-bool is_busy() {
-  return i2c_state_machine_vals_I2C1.not_available;
+/***************************************************************************//**
+ * @brief
+ *  Posts a callback event with the status i2c_status_get() will return for it.
+ *
+ * @details
+ *  Used by i2c_complete() for every transaction, and by drivers that end a transaction of their
+ *  own without the bus, such as a refused transfer or a result handed on to another event. A zero
+ *  callback posts nothing. Safe from interrupt handlers.
+ *
+ * @param[in] callback
+ *  Scheduled event to post, a single bit, or 0
+ *
+ * @param[in] status
+ *  Outcome carried with the event
+ ******************************************************************************/
+void i2c_event_post(uint32_t callback, I2C_STATUS status) {
+  if (!callback) return;
+  i2c_event_status[i2c_event_slot(callback)] = status;
+  add_scheduled_event(callback);
 }
 
+/***************************************************************************//**
+ * @brief
+ *  Returns the i2c_event_status slot of a callback event, the number of its bit.
+ ******************************************************************************/
+static uint32_t i2c_event_slot(uint32_t callback) {
+  uint32_t slot = 0;
+
+  EFM_ASSERT(callback && !(callback & (callback - 1)));
+  while (!(callback & (1UL << slot))) slot++;
+  return slot;
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Copies the failed attempts per cause, the transactions that failed for good, refused ones included,
+ *  and the longest submission to completion time seen on an I2C peripheral.
+ *
+ * @param[out] errors
+ *  Array of I2C_STATUSES entries, indexed by I2C_STATUS
+ ******************************************************************************/
+void i2c_error_stats_get(I2C_TypeDef *i2c, uint32_t *errors, uint32_t *failures, uint32_t *latency_max) {
+  I2C_STATE_MACHINE *sm = i2c_sm_get(i2c);
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  for (uint32_t i = 0; i < I2C_STATUSES; i++) errors[i] = sm->errors[i];
+  *failures = sm->failures + sm->refused;
+  *latency_max = sm->latency_max;
+  CORE_EXIT_CRITICAL();
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Returns the longest a transaction at the head of the queue can take to complete, in LETIMER ticks.
+ *
+ * @details
+ *  Every attempt ends within I2C_TIMEOUT_TICKS, plus the time until i2c_service() next runs to notice
+ *  it, and every retry waits its backoff plus again the time until i2c_service() runs. With the RTCC
+ *  armed on each deadline that time is the wakeup and scheduler latency, not a LETIMER period. After
+ *  I2C_ATTEMPTS attempts the transaction is completed with an error, so this bound holds whatever the
+ *  devices on the bus do. A transaction queued behind others adds their bound to its own.
+ *
+ * @param[in] service_interval
+ *  Longest time from a deadline to the i2c_service() call that handles it, in LETIMER ticks
+ ******************************************************************************/
+uint32_t i2c_worst_case_ticks(uint32_t service_interval) {
+  uint32_t ticks = I2C_ATTEMPTS * (I2C_TIMEOUT_TICKS + service_interval);
 
+  for (uint32_t i = 0; i < I2C_ATTEMPTS - 1; i++) {
+      ticks += (I2C_BACKOFF_TICKS << i) + service_interval;
+  }
+  return ticks;
+}
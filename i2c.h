@@ -7,10 +7,27 @@
 #include "sleep_routines.h"
 #include "Si1133.h"
 #include "scheduler.h"
+#include "ldma.h"
+#include "letimer.h"
+#include "rtcc.h"
 
 #define READ_OP 1
 #define WRITE_OP 0
 #define BIT_SHIFT_EIGHT 8
+#define I2C_QUEUE_DEPTH 8 //transactions that can wait for the bus per I2C peripheral
+#define I2C_WRITE_INLINE 8 //writes up to this many bytes are copied into the transaction
+#define I2C_LDMA_MAX_READ 26 //longest read the LDMA descriptor list can take, longer ones fall back to interrupts
+#define I2C_LDMA_DESCRIPTORS (2*I2C_LDMA_MAX_READ + 1) //one read and one ACK/NACK write per byte, plus the STOP
+#define I2C_TRIGGER_MAX_WRITE 4 //longest write i2c_trigger_write_open() can replay on each trigger
+#define I2C_TRIGGER_DESCRIPTORS 5 //wait for the edge, clear it, START, address, data
+
+//Error recovery, times in RTCC ticks
+#define I2C_ATTEMPTS 3 //tries per transaction before it is completed with an error status
+#define I2C_TIMEOUT_TICKS 10 //an attempt still on the bus after this long is aborted, the longest transfer takes under 1 ms
+#define I2C_BACKOFF_TICKS 2 //wait before the first retry, doubled for each retry after it
+#define I2C_EVENT_SLOTS 32 //one status per scheduler event bit, see i2c_status_get()
+#define I2C_RESET_SPIN 20000 //polls of MSTOP during a bus reset before giving up on the bus
+#define I2C_ERROR_IRQS (I2C_IF_NACK | I2C_IF_ARBLOST | I2C_IF_BUSERR | I2C_IF_CLTO)
 
 typedef struct {  //Used by a device such as the Si1133 module to open an i2c peripheral
 
@@ -23,41 +40,123 @@ typedef struct {  //Used by a device such as the Si1133 module to open an i2c pe
   bool sda_enable;
   uint32_t scl_route;
   uint32_t sda_route;
+  bool ldma_en; //move the data phase with the LDMA instead of one interrupt per byte
+  uint32_t service_cb; //event posted when a timeout, a retry or a bus reset is due, its handler calls i2c_service()
 
 } I2C_OPEN_STRUCT;
 
-
-typedef enum { //my three states
-  init_process,
+typedef enum { //how the data phase of a transaction was moved
+  I2C_MODE_IRQ,
+  I2C_MODE_LDMA,
+  I2C_MODES
+}I2C_MODE;
+
+typedef enum { //outcome of a transaction, read with i2c_status_get() from its callback
+  I2C_STATUS_OK,
+  I2C_STATUS_NACK, //the device did not acknowledge its address or a byte
+  I2C_STATUS_ARBLOST, //another master or a glitch took the bus
+  I2C_STATUS_BUSERR, //START or STOP in the middle of a byte
+  I2C_STATUS_TIMEOUT, //SCL held low, or the attempt outlived I2C_TIMEOUT_TICKS
+  I2C_STATUS_REFUSED, //the queue was full and the transaction never went out, see i2c_event_post()
+  I2C_STATUSES
+}I2C_STATUS;
+
+typedef struct { //cost of the transactions completed in one mode
+  uint32_t transactions;
+  uint32_t interrupts; //I2C interrupts taken, MSTOP included
+  uint32_t bytes; //data bytes written and read, device addresses excluded
+} I2C_STATS;
+
+
+typedef enum { //my states
+  init_process,     //device address with the write bit sent
+  write_data,       //sending the register address and write data
+  restart_process,  //repeated START and device address with the read bit sent
   read_data,
-  stop_data,
-  write_data
+  stop_data
 }DEFINED_STATES;
 
 
-typedef struct { //Defines the I2C operation and keeps state of the I2C state machine
-    I2C_TypeDef *i2c_state; //could be either I2C1 or I2C0
-
-    uint32_t counter_var; //a counter for all the ACK interrupts that will be used in the ACK state machine.
-    uint32_t receive_counter; //another counter on the RXDATA state machine.
-    DEFINED_STATES curr_state;
-    bool not_available; // third set of elements
+typedef struct { //A transaction waiting in the queue of an I2C peripheral
     uint32_t dev_address; //I2C device address
-    uint32_t register_address; //I2C register address being requested
-    uint32_t read_write_op; // for read or write, either READ_OP or WRITE_OP
-    uint32_t *num_data; //Pointer of where to store a read result or get the write data
-    uint32_t number_bytes; //how many bytes to transfer
+    const uint8_t *write_ext; //caller buffer for writes longer than I2C_WRITE_INLINE, NULL otherwise
+    uint8_t write_inline[I2C_WRITE_INLINE]; //short writes, typically a register address and a few bytes, are copied here
+    uint32_t write_len; //bytes written after the device address, the register address being the first one
+    uint8_t *read_buf; //where to store the bytes read after the repeated START
+    uint32_t read_len; //bytes to read, 0 for a write only transaction
     uint32_t callback_i2c; // The callback event to request upon completion of the I2C operation
+    uint32_t submit_time; //RTCC time the transaction was submitted, for the completion latency
+} I2C_TRANSACTION;
 
+typedef struct i2c_instance I2C_INSTANCE;
+
+typedef struct { //Defines the I2C operation and keeps state of the I2C state machine
+    I2C_TypeDef *i2c_state; //could be either I2C1 or I2C0
+    const I2C_INSTANCE *instance; //fixed resources of the peripheral this state machine drives, linked by i2c_open()
+    DEFINED_STATES curr_state;
+    volatile bool not_available; // true while a transaction is active or queued
+    I2C_TRANSACTION active; //copy of the transaction on the bus
+    const uint8_t *write_ptr; //write data of the active transaction, inline or the caller buffer
+    uint32_t write_index; //next byte to write
+    uint32_t read_index; //next byte to read
+
+    bool ldma_en;
+    I2C_MODE mode; //mode of the active transaction
+    uint32_t irq_count; //interrupts taken by the active transaction
+    I2C_STATS stats[I2C_MODES];
+    LDMA_Descriptor_t ldma_desc[I2C_LDMA_DESCRIPTORS];
+
+    uint32_t attempt; //failed attempts of the active transaction so far
+    uint32_t attempt_time; //RTCC time the current attempt started
+    bool reset_pending; //an attempt failed in the interrupt handler, the bus reset waits for i2c_service()
+    I2C_STATUS error_status; //cause of the failed attempt while reset_pending
+    uint32_t error_ien; //interrupts of the peripheral, masked from the failure to the bus reset
+    bool retry_pending; //the bus has been reset and the active transaction waits out its backoff
+    uint32_t retry_time; //RTCC time the retry is due
+    uint32_t errors[I2C_STATUSES]; //failed attempts per cause
+    uint32_t failures; //transactions completed with an error status
+    uint32_t latency_max; //longest submission to completion time seen, in RTCC ticks
+    uint32_t refused; //transfers turned away because the queue was full
+
+    I2C_TRANSACTION queue[I2C_QUEUE_DEPTH]; //transactions submitted while the bus was busy
+    uint32_t queue_head; //oldest waiting transaction
+    uint32_t queue_count;
+
+    bool trigger_wanted; //i2c_trigger_write_open() was called, the write is armed whenever the bus is free
+    bool trigger_armed; //the LDMA owns the bus and waits for the PRS edge
+    uint32_t trigger_prs_ch; //PRS channel, and LDMA SYNC bit, of the trigger
+    uint32_t trigger_ien; //interrupts of the peripheral, masked while armed
+    uint8_t trigger_buf[I2C_TRIGGER_MAX_WRITE];
+    LDMA_Descriptor_t trigger_desc[I2C_TRIGGER_DESCRIPTORS];
 
 } I2C_STATE_MACHINE; //page 26
 
+struct i2c_instance { //Everything that differs between I2C0 and I2C1, one entry per peripheral in i2c.c
+    I2C_TypeDef *regs;
+    I2C_STATE_MACHINE *sm;
+    CMU_Clock_TypeDef clock;
+    IRQn_Type irq;
+    uint32_t sleep_block; //energy mode blocked while a transaction of this peripheral is on the bus
+    uint32_t ldma_ch;
+    LDMA_PeripheralSignal_t ldma_rx_signal;
+    LDMA_PeripheralSignal_t ldma_tx_signal;
+    uint32_t trigger_ch; //channel of the write replayed on a PRS edge
+};
+
 
-void i2c_start(I2C_TypeDef *i2c, uint32_t device_add, uint32_t register_add, uint32_t read_write, uint32_t callback, uint32_t *data, uint32_t number_bytes);
+bool i2c_transfer(I2C_TypeDef *i2c, uint32_t device_add, const uint8_t *write_buf, uint32_t write_len, uint8_t *read_buf, uint32_t read_len, uint32_t callback);
 void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup);
 void I2C0_IRQHandler(void);
 void I2C1_IRQHandler(void);
 uint32_t send_si1133_data(); //this is for the scheduled callback function that will be used in app.c
-bool is_busy();
+bool i2c_busy(I2C_TypeDef *i2c);
+void i2c_trigger_write_open(I2C_TypeDef *i2c, uint32_t device_add, const uint8_t *write_buf, uint32_t write_len, uint32_t prs_ch);
+void i2c_ldma_enable(I2C_TypeDef *i2c, bool enable);
+void i2c_stats_get(I2C_TypeDef *i2c, I2C_STATS *stats);
+void i2c_service(void);
+I2C_STATUS i2c_status_get(uint32_t callback);
+void i2c_event_post(uint32_t callback, I2C_STATUS status);
+void i2c_error_stats_get(I2C_TypeDef *i2c, uint32_t *errors, uint32_t *failures, uint32_t *latency_max);
+uint32_t i2c_worst_case_ticks(uint32_t service_interval);
 
 #endif /* HEADER_FILES_I2C_H_ */
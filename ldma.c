@@ -0,0 +1,121 @@
+/**
+ * @file ldma.c
+ * @author agent
+ * @date 10/18/2026
+ * @brief Shared LDMA controller setup and channel start/stop for the peripheral drivers
+ *
+ */
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "ldma.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static bool ldma_opened = false;
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *  Enables the LDMA clock and initializes the controller.
+ *
+ * @details
+ *  Every driver that uses a channel calls this from its own open function, only the first
+ *  call does anything. Drivers build their descriptors with doneIfs cleared and finish the
+ *  transfer on an interrupt of their own peripheral, so the LDMA interrupt is only used by
+ *  the emlib handler to report errors.
+ *
+ * @note
+ *  The LDMA is a high frequency peripheral; a driver with a transfer in flight must block EM2.
+ ******************************************************************************/
+void ldma_open(void) {
+  LDMA_Init_t ldma_init = LDMA_INIT_DEFAULT;
+
+  if (ldma_opened) return;
+  CMU_ClockEnable(cmuClock_LDMA, true);
+  LDMA_Init(&ldma_init);
+  ldma_opened = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Starts a descriptor list on a channel, paced by a peripheral request.
+ *
+ * @param[in] channel
+ *  One of the LDMA_CH_ channels
+ *
+ * @param[in] signal
+ *  Peripheral request that paces the transfer, ldmaPeripheralSignal_NONE for a memory transfer
+ *
+ * @param[in] descriptor
+ *  First descriptor of the list; it must stay valid until the transfer is done
+ ******************************************************************************/
+void ldma_start(uint32_t channel, LDMA_PeripheralSignal_t signal, const LDMA_Descriptor_t *descriptor) {
+  LDMA_TransferCfg_t cfg = LDMA_TRANSFER_CFG_PERIPHERAL(signal);
+
+  EFM_ASSERT(ldma_opened);
+  LDMA_StartTransfer(channel, &cfg, descriptor);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Stops a channel, for instance when the peripheral it feeds has aborted.
+ ******************************************************************************/
+void ldma_stop(uint32_t channel) {
+  LDMA_StopTransfer(channel);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns true while a channel still has descriptors to process.
+ *
+ * @details
+ *  Reads the channel enable, which the LDMA clears after the last descriptor. Unlike
+ *  LDMA_TransferDone(), a channel never started or stopped with ldma_stop() is not busy.
+ ******************************************************************************/
+bool ldma_busy(uint32_t channel) {
+  return (LDMA->CHEN & (1UL << channel)) != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Lets a rising edge of a PRS channel set the LDMA SYNC bit of the same number.
+ *
+ * @details
+ *  A SYNC descriptor waiting on that bit then starts its list with no interrupt and no CPU. The
+ *  bit stays set until a descriptor or ldma_sync_clear() clears it, so an edge is not lost while
+ *  the list is busy with the previous one.
+ *
+ * @param[in] prs_ch
+ *  PRS channel, 0 to 7
+ ******************************************************************************/
+void ldma_sync_prs_enable(uint32_t prs_ch, bool enable) {
+  uint32_t mask = 1UL << (_LDMA_CTRL_SYNCPRSSETEN_SHIFT + prs_ch);
+
+  EFM_ASSERT(ldma_opened && prs_ch < 8);
+  if (enable) LDMA->CTRL |= mask;
+  else LDMA->CTRL &= ~mask;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Clears LDMA SYNC bits, for instance an edge left pending by a list that has been stopped.
+ ******************************************************************************/
+void ldma_sync_clear(uint32_t mask) {
+  LDMA->SYNC &= ~mask;
+}
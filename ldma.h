@@ -0,0 +1,48 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef LDMA_HG
+#define LDMA_HG
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+#include "em_ldma.h"
+#include "em_cmu.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+// LDMA channel owned by each driver, so transfers of different peripherals never share a channel
+#define LDMA_CH_I2C0      0
+#define LDMA_CH_I2C1      1
+#define LDMA_CH_I2C0_TRIG 2 //descriptor loop writing on a PRS trigger, see i2c_trigger_write_open()
+#define LDMA_CH_I2C1_TRIG 3
+#define LDMA_CH_RGB_RED   4 //fade of each RGB LED color, see rgb_fade_start()
+#define LDMA_CH_RGB_GREEN 5
+#define LDMA_CH_RGB_BLUE  6
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void ldma_open(void);
+void ldma_start(uint32_t channel, LDMA_PeripheralSignal_t signal, const LDMA_Descriptor_t *descriptor);
+void ldma_stop(uint32_t channel);
+bool ldma_busy(uint32_t channel);
+void ldma_sync_prs_enable(uint32_t prs_ch, bool enable);
+void ldma_sync_clear(uint32_t mask);
+
+#endif
@@ -22,10 +22,23 @@
   static uint32_t scheduled_comp0_cb;
   static uint32_t scheduled_comp1_cb;
   static uint32_t scheduled_uf_cb;
+  static volatile uint32_t elapsed_ticks; //time base ticks accumulated at every underflow
+  static volatile uint32_t elapsed_rem; //fraction of a time base tick left over, in LETIMER_TIME_HZ / LETIMER_HZ
+  static volatile uint32_t current_top; //COMP0 the counter was reloaded with at the last underflow
+  static volatile uint32_t pending_top; //period waiting for the next underflow to be written to COMP0
+  static volatile bool period_pending;
+  static volatile bool period_loaded; //written to COMP0, counting from the next underflow on
+  static uint32_t period_request_time; //letimer_time_get() when the pending period was requested
+  static volatile uint32_t period_latency; //ticks from the last request to the first period counted with it
+  static bool burst_active; //LETIMER0 counts a burst in buffered repeat mode
+  static volatile bool burst_stopped; //the burst is over and the counter stopped by itself
+  static uint32_t burst_saved_top; //period to go back to after the burst
+  static uint32_t burst_done_cb;
 
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
+static void letimer_rebase(LETIMER_TypeDef *letimer, uint32_t top, uint32_t now);
 
 
 //***********************************************************************************
@@ -64,12 +77,12 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 
 	//THE LETIMER_Init_TypeDef STRUCT used by the LETIMER_Init() function is not the same as the APP_LETIMER_PWM_TypeDef(what we did earlier)
 
-	unsigned int period_cnt;
-	unsigned int period_active_cnt;
 	//LETIMER0
+	EFM_ASSERT(LETIMER_PWM_VALID(app_letimer_struct->period, app_letimer_struct->active_period));
 
 	 if(letimer == LETIMER0) {
 	     CMU_ClockEnable(cmuClock_LETIMER0, true); // 16) b) v) and vi) ?
+	     CMU_ClockDivSet(cmuClock_LETIMER0, 1 << LETIMER_PRESCALER); //LETIMER_HZ, sized for LETIMER_MAX_PERIOD_MS
 	 }
 
 	 letimer_start(letimer,false);
@@ -102,6 +115,11 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 
   // Reset the Counter to a know value such as 0
   letimer->CNT = 0; // What is the register enumeration to use to specify the LETIMER Counter Register?
+  current_top = 0; //the first underflow comes one tick after the start
+  burst_active = false;
+  burst_stopped = false;
+  period_pending = false;
+  period_loaded = false;
 
   // Initialize letimer for PWM operation
 
@@ -124,10 +142,8 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
    * with the calculated values
    */
 
-	period_cnt = app_letimer_struct->period * LETIMER_HZ;
-	period_active_cnt = app_letimer_struct->active_period * LETIMER_HZ;
-	LETIMER_CompareSet(letimer, 0, period_cnt);				    // comp0 register is PWM period
-	LETIMER_CompareSet(letimer, 1, period_active_cnt);		// comp1 register is PWM active period
+	LETIMER_CompareSet(letimer, 0, app_letimer_struct->period);				    // comp0 register is PWM period
+	LETIMER_CompareSet(letimer, 1, app_letimer_struct->active_period);		// comp1 register is PWM active period
 
 	//as of now 16) n) has been completed
 
@@ -212,10 +228,32 @@ void LETIMER0_IRQHandler(void) {
 
     if (LETIMER_IF_UF & int_flag) {
         EFM_ASSERT(!(LETIMER0->IF & LETIMER_IF_UF));
+        elapsed_rem += (current_top + 1) * LETIMER_TIME_HZ;
+        elapsed_ticks += elapsed_rem / LETIMER_HZ;
+        elapsed_rem %= LETIMER_HZ;
+        current_top = LETIMER_CompareGet(LETIMER0, 0);
+        if (period_loaded) {
+            period_latency = elapsed_ticks - period_request_time;
+            period_loaded = false;
+        }
+        if (period_pending) {
+            LETIMER_CompareSet(LETIMER0, 0, pending_top); //reloaded at the next underflow, the period just started keeps its length
+            period_pending = false;
+            period_loaded = true;
+        }
         add_scheduled_event(scheduled_uf_cb);
        // LETIMER_IntClear(letimer, scheduled_uf_cb);
     }
 
+    if (LETIMER_IF_REP0 & int_flag) { //also raised when REP1 is moved into REP0, the burst then goes on
+        if (LETIMER0->REP1 == 0 && !(LETIMER0->STATUS & LETIMER_STATUS_RUNNING)) {
+            LETIMER0->IEN &= ~LETIMER_IEN_REP0;
+            burst_stopped = true;
+            sleep_unblock_mode(LETIMER_EM); //the counter stopped itself, letimer_start() will not see it running
+            add_scheduled_event(burst_done_cb);
+        }
+    }
+
 
   }
 
@@ -257,67 +295,314 @@ LETIMER_Enable(letimer, enable); //part h of the lab
 
 /***************************************************************************//**
  * @brief
- *  In this function, the PWM active period is altered using the input parameters.
+ *  In this function, the PWM period is altered by a signed number of ticks.
  *
  * @details
- *  First we make sure to disable the LETIMER0 from running before we make changes to the PWM
- *  period. Then we read the current comp0_read_value which is the current speed and then add
- *  that to the input parameter. Typecasting has to be done to the current COMP0 register value.
- *  Then the new value will be stored into a local variable and then the function will write to the COMP0 value (register)
- *  the new PWM period using LETIMER_CompareSet(LETIMER_TypeDef *letimer, unsigned int comp, uint32_t value)
- *  After we have done all of this, the LETIMER0 will be enabled again.
- *
- * @note
- *
- *
+ *  The current COMP0 period, or the one still waiting for the next underflow, is read and the input
+ *  parameter is added to it as a signed value, so a large decrement can no longer wrap around to a
+ *  huge period. The new period goes through letimer_period_set(), which checks its range and applies
+ *  it at the next underflow without stopping the LETIMER.
  *
  * @param[in] letimer
  *   Pointer to the base peripheral address of the LETIMER peripheral being opened
  *
  * @param[in] increment_decrement
- * The change amount that we implement to the current active period, will either be +999 if we are looking to
+ * The change amount that we implement to the current period, will either be +999 if we are looking to
  * decrease the time we get data on our phone, which is approximately a 1 second delay. Or it will either be -999,
  * which speeds up the data by approx a 1 second.
+ *
+ * @return
+ *  false when the new period is out of range and nothing was changed
  ******************************************************************************/
 
-void compare_set(LETIMER_TypeDef * letimer, int increment_decrement) {
+bool compare_set(LETIMER_TypeDef * letimer, int increment_decrement) {
+  int32_t result = (int32_t)letimer_period_get(letimer) + increment_decrement;
 
-  //from lecture video nov 29
-  // changing the counter
-  // new function compare_set with atleast two inputs, typedef
-  //if letimer0 is enabled, then disable it
-  //read the value of comp0
-  //create a local integer result
-  // result = (int) comp0 value + increment_decrement;
-  //update comp0 with the value that was just created.
-  //enable LETIMER0
-  //if letimer disabled, steps two to 4
+  if (result <= 0) return false;
+  return letimer_period_set(letimer, result);
+}
 
-  uint32_t comp0_read_value;
-  uint32_t local_integer_result;
+/***************************************************************************//**
+ * @brief
+ *  Changes the PWM period at the next cycle boundary, without stopping the LETIMER.
+ *
+ * @details
+ *  Stopping the counter to rewrite COMP0 stretches the period in progress and waits on SYNCBUSY
+ *  twice. Instead the new value is left for the underflow interrupt, which writes COMP0 right after
+ *  the counter was reloaded from it, so the period just started keeps its length and the next one
+ *  counts with the new value. A second request before that underflow replaces the first. The time
+ *  from the request to the start of the first period counted with it is kept for
+ *  letimer_period_latency_get(); it is up to two periods, the one in progress and the one already
+ *  loaded, which tools/letimer_sim.py reproduces on the host. A LETIMER that is not running takes
+ *  the value at once.
+ *
+ * @note
+ *  The hardware way would be CTRL.BUFTOP, which reloads COMP0 from COMP1 when REP0 runs out. COMP1
+ *  holds the active period of the PWM here, so it cannot double as the COMP0 buffer, and the
+ *  interrupt handler writes the pending COMP0 instead.
+ *
+ * @param[in] letimer
+ *   Pointer to the base peripheral address of the LETIMER peripheral
+ *
+ * @param[in] period
+ *   New COMP0 value in ticks, above COMP1 so the active period still fits, at most _LETIMER_COMP0_MASK
+ *
+ * @return
+ *  false when the period is out of range and nothing was changed
+ ******************************************************************************/
+bool letimer_period_set(LETIMER_TypeDef *letimer, uint32_t period) {
+  EFM_ASSERT(letimer == LETIMER0);
+  if (period <= LETIMER_CompareGet(letimer, 1) || period > _LETIMER_COMP0_MASK) return false;
+  if (burst_active) return false;
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  if (letimer->STATUS & LETIMER_STATUS_RUNNING) {
+      pending_top = period;
+      period_pending = true;
+      period_request_time = letimer_time_get();
+  }
+  else {
+      LETIMER_CompareSet(letimer, 0, period);
+      period_pending = false;
+  }
+  CORE_EXIT_CRITICAL();
+  return true;
+}
 
-  if(LETIMER0->STATUS & LETIMER_STATUS_RUNNING)
-    {
-      LETIMER_Enable(LETIMER0, false);
-      while(letimer->SYNCBUSY);
-      comp0_read_value = LETIMER_CompareGet(LETIMER0, 0);
-      local_integer_result =(int)comp0_read_value + increment_decrement;
+/***************************************************************************//**
+ * @brief
+ *  Returns the time base ticks (ms) from the last letimer_period_set() to the start of the first
+ *  period counted with it, 0 before any change has taken effect.
+ ******************************************************************************/
+uint32_t letimer_period_latency_get(void) {
+  return period_latency;
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Returns a free running time base in LETIMER_TIME_HZ ticks (milliseconds), whatever the LETIMER0 clock.
+ *
+ * @details
+ *  The LETIMER0 interrupt handler accumulates one full period (COMP0 + 1 ticks) on every
+ *  underflow, converted from LETIMER_HZ to LETIMER_TIME_HZ with the remainder carried over,
+ *  so the time base keeps its unit with the LFXO and a prescaler. The ticks already counted down in the current period are added on top of
+ *  that, from the top the counter was reloaded with, which a pending letimer_period_set()
+ *  does not touch. If an underflow is pending but not yet serviced, the period it completed
+ *  is added here so the time base never steps backwards.
+ *
+ * @note
+ *  The time base only advances while LETIMER0 is running. Differences between two readings
+ *  are valid across the 32 bit wrap as long as unsigned arithmetic is used.
+ *
+ * @return
+ *  The current time in LETIMER0 ticks.
+ ******************************************************************************/
+uint32_t letimer_time_get(void) {
+  uint32_t ticks;
+  uint32_t counted; //counter ticks since the last underflow the handler accounted for
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  counted = current_top - LETIMER_CounterGet(LETIMER0);
+  if (burst_stopped) {
+      counted = 0; //the last underflow of the burst is accounted for, and the counter no longer moves
+  }
+  else if ((LETIMER0->IF & LETIMER_IF_UF) && (LETIMER0->IEN & LETIMER_IEN_UF)) {
+      counted = current_top + 1 + (LETIMER_CompareGet(LETIMER0, 0) - LETIMER_CounterGet(LETIMER0));
+  }
+  ticks = elapsed_ticks + (elapsed_rem + counted * LETIMER_TIME_HZ) / LETIMER_HZ;
+  CORE_EXIT_CRITICAL();
 
-      LETIMER_CompareSet(LETIMER0,0, local_integer_result);
-      LETIMER_Enable(LETIMER0, true);
-      while(letimer->SYNCBUSY);
+  return ticks;
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Returns the PWM period the LETIMER runs with, in ticks, as programmed in COMP0, or the one
+ *  waiting for the next underflow after letimer_period_set().
+ *
+ * @param[in] letimer
+ *   Pointer to the base peripheral address of the LETIMER peripheral
+ ******************************************************************************/
+uint32_t letimer_period_get(LETIMER_TypeDef *letimer) {
+  if (period_pending) return pending_top;
+  return LETIMER_CompareGet(letimer, 0);
+}
 
-    }
+/***************************************************************************//**
+ * @brief
+ *  Works out the LETIMER0 clock a policy gives for a range of periods, and what it costs.
+ *
+ * @details
+ *  The prescaler is the smallest one that keeps max_period_ms within COMP0, so the resolution is
+ *  the finest the range allows. The ULFRCO runs in every energy mode down to EM4H anyway and costs
+ *  nothing extra, but it is only good to about +-20 %. The LFXO is a crystal, good to
+ *  LETIMER_LFXO_PPM, but it costs its own current and stops in EM3, so the MCU sleeps in EM2.
+ *  The build uses LETIMER_CLOCK_POLICY and LETIMER_MAX_PERIOD_MS, whose compile time equivalents
+ *  set LETIMER_HZ; this function reports any other choice for comparison.
+ *
+ * @param[in] policy
+ *  LETIMER_CLOCK_ULFRCO for the lowest power or LETIMER_CLOCK_LFXO for accuracy
+ *
+ * @param[in] max_period_ms
+ *  Longest period the LETIMER has to count
+ *
+ * @param[out] config
+ *  Prescaler, tick rate, resolution, drift and current of that configuration
+ ******************************************************************************/
+void letimer_clock_config(uint32_t policy, uint32_t max_period_ms, LETIMER_CLOCK_CONFIG *config) {
+  uint32_t source_hz = (policy == LETIMER_CLOCK_LFXO) ? LETIMER_LFXO_HZ : LETIMER_ULFRCO_HZ;
+  uint64_t ticks = (uint64_t)max_period_ms * source_hz / 1000;
+  uint32_t prescaler = 0;
+
+  while ((ticks >> prescaler) > LETIMER_TICKS_MAX) prescaler++;
+  EFM_ASSERT(prescaler <= 15);
+  config->policy = policy;
+  config->prescaler = prescaler;
+  config->hz = source_hz >> prescaler;
+  config->resolution_ns = 1000000000 / config->hz;
+  config->drift_ppm = (policy == LETIMER_CLOCK_LFXO) ? LETIMER_LFXO_PPM : LETIMER_ULFRCO_PPM;
+  config->current_na = (policy == LETIMER_CLOCK_LFXO) ? LETIMER_LFXO_NA + LETIMER_EM2_NA : 0;
+  config->lowest_em = (policy == LETIMER_CLOCK_LFXO) ? EM2 : EM3;
+}
 
-  else {
-      comp0_read_value = LETIMER_CompareGet(LETIMER0, 0);
-      local_integer_result =(int)comp0_read_value + increment_decrement;
-      LETIMER_CompareSet(LETIMER0,0, local_integer_result);
-      LETIMER_Enable(LETIMER0, true);
-      while(letimer->SYNCBUSY);
-  }
+/***************************************************************************//**
+ * @brief
+ *  Restarts the time base bookkeeping of a stopped LETIMER0 at a new top, keeping time continuous.
+ *
+ * @param[in] top
+ *  COMP0 the counter starts from
+ *
+ * @param[in] now
+ *  Time base value the restarted counter starts at
+ ******************************************************************************/
+static void letimer_rebase(LETIMER_TypeDef *letimer, uint32_t top, uint32_t now) {
+  letimer->CNT = top;
+  while (letimer->SYNCBUSY);
+  current_top = top;
+  elapsed_ticks = now;
+  elapsed_rem = 0;
+  period_pending = false;
+  period_loaded = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Takes a burst of samples at a faster period, counted and ended by the LETIMER itself.
+ *
+ * @details
+ *  LETIMER0 is switched to buffered repeat mode with REP0 = min(samples, LETIMER_REP_MAX) and the
+ *  rest in REP1, which the hardware loads into REP0 when it runs out. Every period still raises COMP1
+ *  and UF as usual, so every sample is taken by the existing callbacks, but nothing in software
+ *  counts them: after the last underflow the counter stops on its own and the REP0 interrupt posts
+ *  done_cb. REP0IF is also raised when REP1 is moved into REP0, so the handler only ends the burst
+ *  once REP1 is empty and the counter has stopped, and then drops the sleep block letimer_start()
+ *  took. Since LETIMER0 is also the heartbeat and the time base, done_cb has to re-arm the normal
+ *  period with letimer_burst_restore(); until then the time base holds at the end of the burst.
+ *  The period in progress is cut short, and letimer_period_set() is refused during the burst.
+ *
+ * @param[in] letimer
+ *   Pointer to the base peripheral address of the LETIMER peripheral
+ *
+ * @param[in] samples
+ *   Periods in the burst, 1 to LETIMER_BURST_MAX
+ *
+ * @param[in] period
+ *   COMP0 of the burst periods in ticks, in the range of letimer_period_set()
+ *
+ * @param[in] done_cb
+ *   Scheduled event posted once the burst is over
+ *
+ * @return
+ *  false, with nothing changed, when a burst is already running or an argument is out of range
+ ******************************************************************************/
+bool letimer_burst_start(LETIMER_TypeDef *letimer, uint32_t samples, uint32_t period, uint32_t done_cb) {
+  uint32_t now;
+
+  EFM_ASSERT(letimer == LETIMER0);
+  if (burst_active || samples == 0 || samples > LETIMER_BURST_MAX) return false;
+  if (period <= LETIMER_CompareGet(letimer, 1) || period > _LETIMER_COMP0_MASK) return false;
+
+  now = letimer_time_get();
+  burst_saved_top = letimer_period_get(letimer);
+  letimer_start(letimer, false);
+  while (letimer->SYNCBUSY);
+  if (letimer->IF & letimer->IEN & LETIMER_IF_UF) add_scheduled_event(scheduled_uf_cb); //its time is in now, its callback is still owed
+  if (letimer->IF & letimer->IEN & LETIMER_IF_COMP1) add_scheduled_event(scheduled_comp1_cb);
+  letimer->IFC = LETIMER_IFC_COMP1 | LETIMER_IFC_UF | LETIMER_IFC_REP0; //accounted for in now
+  LETIMER_CompareSet(letimer, 0, period);
+  letimer_rebase(letimer, period, now);
+  letimer->CTRL = (letimer->CTRL & ~_LETIMER_CTRL_REPMODE_MASK) | LETIMER_CTRL_REPMODE_BUFFERED;
+  while (letimer->SYNCBUSY);
+  LETIMER_RepeatSet(letimer, 0, (samples > LETIMER_REP_MAX) ? LETIMER_REP_MAX : samples);
+  if (samples > LETIMER_REP_MAX) LETIMER_RepeatSet(letimer, 1, samples - LETIMER_REP_MAX);
+  burst_done_cb = done_cb;
+  burst_active = true;
+  burst_stopped = false;
+  letimer->IEN |= LETIMER_IEN_REP0;
+  letimer_start(letimer, true);
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Puts LETIMER0 back into free running mode at the period it had before the burst.
+ *
+ * @details
+ *  Called from the done_cb of letimer_burst_start(). The time base carries on from the end of the
+ *  burst; the scheduling latency between the two is not counted.
+ ******************************************************************************/
+void letimer_burst_restore(LETIMER_TypeDef *letimer) {
+  EFM_ASSERT(letimer == LETIMER0 && burst_active);
+  letimer_start(letimer, false);
+  while (letimer->SYNCBUSY);
+  letimer->CTRL = (letimer->CTRL & ~_LETIMER_CTRL_REPMODE_MASK) | LETIMER_CTRL_REPMODE_FREE;
+  while (letimer->SYNCBUSY);
+  LETIMER_RepeatSet(letimer, 0, 0b11); //as in letimer_pwm_open()
+  LETIMER_RepeatSet(letimer, 1, 0b11);
+  LETIMER_CompareSet(letimer, 0, burst_saved_top);
+  letimer_rebase(letimer, burst_saved_top, elapsed_ticks);
+  burst_active = false;
+  burst_stopped = false;
+  letimer_start(letimer, true);
+}
 
+/***************************************************************************//**
+ * @brief
+ *  Returns true from letimer_burst_start() until letimer_burst_restore().
+ ******************************************************************************/
+bool letimer_burst_active(void) {
+  return burst_active;
 }
 
+/***************************************************************************//**
+ * @brief
+ *  Sends the rising edge of OUT1, the COMP1 match of every period, to a PRS channel in place of
+ *  the COMP1 interrupt.
+ *
+ * @details
+ *  OUT1 runs in PWM mode, set on the COMP1 match and cleared on underflow, whether or not it is
+ *  routed to a pin. Its rising edge on the PRS channel lets a peripheral or the LDMA act at COMP1
+ *  without waking the CPU, so the COMP1 interrupt is masked while the channel is open. Bursts and
+ *  period changes move the edge along with COMP1.
+ *
+ * @param[in] prs_ch
+ *  PRS channel the edge is sent to
+ *
+ * @param[in] enable
+ *  false gives COMP1 back to its interrupt
+ ******************************************************************************/
+void letimer_prs_open(LETIMER_TypeDef *letimer, uint32_t prs_ch, bool enable) {
+  EFM_ASSERT(letimer == LETIMER0);
+  CMU_ClockEnable(cmuClock_PRS, true);
+  if (enable) {
+      PRS_SourceSignalSet(prs_ch, PRS_CH_CTRL_SOURCESEL_LETIMER0, PRS_CH_CTRL_SIGSEL_LETIMER0CH1, prsEdgePos);
+      letimer->IEN &= ~LETIMER_IEN_COMP1;
+  }
+  else {
+      PRS_SourceSignalSet(prs_ch, 0, 0, prsEdgeOff);
+      letimer->IFC = LETIMER_IFC_COMP1;
+      letimer->IEN |= LETIMER_IEN_COMP1;
+  }
+}
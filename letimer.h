@@ -13,6 +13,7 @@
 #include "em_letimer.h"
 #include "em_gpio.h"
 #include "em_cmu.h"
+#include "em_prs.h"
 #include "em_assert.h"
 
 /* The developer's include statements */
@@ -21,8 +22,35 @@
 //***********************************************************************************
 // defined files
 //***********************************************************************************
-#define LETIMER_HZ		1000			// Utilizing ULFRCO oscillator for LETIMERs
-#define LETIMER_EM    EM4 //using the ULFRCO, block from entering energy mode 4
+#define LETIMER_CLOCK_ULFRCO  0   // lowest power: always running anyway, 1 ms resolution, about +-20 %
+#define LETIMER_CLOCK_LFXO    1   // accuracy: the 32.768 kHz crystal, tens of ppm, but no EM3
+#define LETIMER_CLOCK_POLICY  LETIMER_CLOCK_ULFRCO
+#define LETIMER_MAX_PERIOD_MS 60000   // longest period the prescaler has to fit, RATE_MAX_MS included
+
+#define LETIMER_ULFRCO_HZ     1000
+#define LETIMER_LFXO_HZ       32768
+#define LETIMER_ULFRCO_PPM    200000
+#define LETIMER_LFXO_PPM      50      // crystal tolerance and temperature
+#define LETIMER_LFXO_NA       250     // crystal oscillator, when nothing else keeps it running
+#define LETIMER_EM2_NA        400     // EM2 floor above EM3, the cost of keeping the LFXO domain alive
+
+#define LETIMER_TICKS_MAX   _LETIMER_COMP0_MASK
+#define LETIMER_REP_MAX     255     // REP0 and REP1 are 8 bits
+#define LETIMER_BURST_MAX   (2 * LETIMER_REP_MAX)   // REP0 plus the buffered REP1
+#define LETIMER_SOURCE_HZ   ((LETIMER_CLOCK_POLICY == LETIMER_CLOCK_LFXO) ? LETIMER_LFXO_HZ : LETIMER_ULFRCO_HZ)
+#define LETIMER_LFA_SELECT  ((LETIMER_CLOCK_POLICY == LETIMER_CLOCK_LFXO) ? cmuSelect_LFXO : cmuSelect_ULFRCO)
+// Smallest prescaler that keeps LETIMER_MAX_PERIOD_MS within COMP0, evaluated at compile time
+#define LETIMER_PRESC_FITS(p) ((((uint64_t)LETIMER_MAX_PERIOD_MS * LETIMER_SOURCE_HZ / 1000) >> (p)) <= LETIMER_TICKS_MAX)
+#define LETIMER_PRESCALER   (LETIMER_PRESC_FITS(0) ? 0 : LETIMER_PRESC_FITS(1) ? 1 : LETIMER_PRESC_FITS(2) ? 2 : LETIMER_PRESC_FITS(3) ? 3 : LETIMER_PRESC_FITS(4) ? 4 : LETIMER_PRESC_FITS(5) ? 5 : LETIMER_PRESC_FITS(6) ? 6 : LETIMER_PRESC_FITS(7) ? 7 : LETIMER_PRESC_FITS(8) ? 8 : LETIMER_PRESC_FITS(9) ? 9 : LETIMER_PRESC_FITS(10) ? 10 : LETIMER_PRESC_FITS(11) ? 11 : LETIMER_PRESC_FITS(12) ? 12 : LETIMER_PRESC_FITS(13) ? 13 : LETIMER_PRESC_FITS(14) ? 14 : 15)
+#define LETIMER_HZ		(LETIMER_SOURCE_HZ >> LETIMER_PRESCALER)			// LETIMER0 counter ticks per second
+#define LETIMER_TIME_HZ 1000   // letimer_time_get() ticks per second, whatever the clock
+#define LETIMER_EM    ((LETIMER_CLOCK_POLICY == LETIMER_CLOCK_LFXO) ? EM3 : EM4) //the LFXO stops in EM3, the ULFRCO does not
+
+// Conversions to LETIMER ticks, rounded to the nearest tick, for constant arguments evaluated at compile time
+#define LETIMER_MS_TO_TICKS(ms)   ((uint32_t)(((uint64_t)(ms) * LETIMER_HZ + 500) / 1000))
+#define LETIMER_S_TO_TICKS(s)     ((uint32_t)((uint64_t)(s) * LETIMER_HZ))
+// True when a PWM period and active period in ticks fit COMP0/COMP1, usable in a static assert
+#define LETIMER_PWM_VALID(period, active)   ((active) > 0 && (active) < (period) && (period) <= LETIMER_TICKS_MAX)
 
 //***********************************************************************************
 // global variables
@@ -34,8 +62,8 @@ typedef struct {
 	uint32_t		out_pin_route1;		// out 1 route to gpio port/pin
 	bool			out_pin_0_en;		// enable out 0 route
 	bool			out_pin_1_en;		// enable out 1 route
-	float			period;				// seconds
-	float			active_period;		// seconds
+	uint32_t		period;				// ticks, see LETIMER_MS_TO_TICKS()
+	uint32_t		active_period;		// ticks
 	//-------------------------------------------------------------------------
 	bool      comp0_irq_enable; //enable interrupt on comp0 interrupt
 	uint32_t  comp0_cb;
@@ -45,13 +73,32 @@ typedef struct {
 	uint32_t  uf_cb; //cb stands for CallBack
 } APP_LETIMER_PWM_TypeDef ;
 
+typedef struct {
+  uint32_t  policy;         // LETIMER_CLOCK_ULFRCO or LETIMER_CLOCK_LFXO
+  uint32_t  prescaler;      // LETIMER0 clock divided by 2^prescaler
+  uint32_t  hz;             // counter ticks per second
+  uint32_t  resolution_ns;  // one counter tick
+  uint32_t  drift_ppm;
+  uint32_t  current_na;     // added on top of the ULFRCO configuration
+  uint32_t  lowest_em;      // deepest energy mode the LETIMER keeps running in
+} LETIMER_CLOCK_CONFIG;
+
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
 void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_letimer_struct); // 15) c) i.) the function prototype of the letimer_pwm_open()
 void letimer_start(LETIMER_TypeDef *letimer, bool enable);
-void compare_set(LETIMER_TypeDef * letimer, int increment_decrement );
+bool compare_set(LETIMER_TypeDef * letimer, int increment_decrement );
+bool letimer_period_set(LETIMER_TypeDef *letimer, uint32_t period);
+uint32_t letimer_period_latency_get(void);
+bool letimer_burst_start(LETIMER_TypeDef *letimer, uint32_t samples, uint32_t period, uint32_t done_cb);
+void letimer_burst_restore(LETIMER_TypeDef *letimer);
+bool letimer_burst_active(void);
+void letimer_prs_open(LETIMER_TypeDef *letimer, uint32_t prs_ch, bool enable);
+void letimer_clock_config(uint32_t policy, uint32_t max_period_ms, LETIMER_CLOCK_CONFIG *config);
 void LETIMER0_IRQHandler(void);
+uint32_t letimer_time_get(void);
+uint32_t letimer_period_get(LETIMER_TypeDef *letimer);
 
 #endif
@@ -54,6 +54,39 @@ static LEUART0_STATE_MACHINE_READ leuart0_read_vals;
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
+static void leuart_idle_byte(LEUART0_STATE_MACHINE_READ *sm_read, char rx_char);
+
+/***************************************************************************//**
+ * @brief
+ *  Runs one received character through the idle pattern matcher.
+ *
+ * @details
+ *  Every pattern keeps the number of its characters matched so far. A mismatch restarts
+ *  the pattern, counting the current character if it is the first one of the pattern.
+ *  When a pattern is complete its index is saved and the idle event is scheduled.
+ *
+ * @param[in] *sm_read
+ *   Pointer to the read state machine holding the patterns.
+ *
+ * @param[in] rx_char
+ *   Character received outside of a start/signal frame.
+ ******************************************************************************/
+void leuart_idle_byte(LEUART0_STATE_MACHINE_READ *sm_read, char rx_char) {
+  for (uint32_t i = 0; i < sm_read->idle_count; i++) {
+      const char *pattern = sm_read->idle_patterns[i];
+      uint32_t progress = sm_read->idle_progress[i];
+
+      if (rx_char == pattern[progress]) progress++;
+      else progress = (rx_char == pattern[0]) ? 1 : 0;
+
+      if (pattern[progress] == 0) {
+          sm_read->idle_match = i;
+          add_scheduled_event(sm_read->idle_evt);
+          progress = 0;
+      }
+      sm_read->idle_progress[i] = progress;
+  }
+}
 
 
 //***********************************************************************************
@@ -289,6 +322,12 @@ void leuart_rxdatav(LEUART0_STATE_MACHINE_READ *sm_read) {
           sm_read->read_counter = sm_read->read_counter + 1;
          break;
       }
+    case INIT_READ:
+      {
+        EFM_ASSERT(sm_read->idle_scan); //only unblocked between frames when scanning for idle patterns
+        leuart_idle_byte(sm_read, sm_read->leuart_state_read->RXDATA);
+        break;
+      }
     default:
           EFM_ASSERT(false);
           break;
@@ -318,7 +357,7 @@ void leuart_sigframe(LEUART0_STATE_MACHINE_READ *sm_read) {
   switch(sm_read->current_state_read) {
     case RECEIVE_DATA:
       {
-        sm_read->leuart_state_read->CMD |= LEUART_CMD_RXBLOCKEN;
+        if (!sm_read->idle_scan) sm_read->leuart_state_read->CMD |= LEUART_CMD_RXBLOCKEN;
 
 
         while(sm_read->leuart_state_read->SYNCBUSY);
@@ -726,3 +765,57 @@ void return_read_val (char * ret_read) {
   strcpy(ret_read, leuart0_read_vals.data_string_rx);
 
 }
+
+
+/***************************************************************************//**
+ * @brief
+ *  Enables matching of unframed strings received between start/signal frames.
+ *
+ * @details
+ *  Modules such as the HM-10 report their state with fixed strings that do not carry the
+ *  start frame character, so the receiver block would throw them away. Once this function
+ *  has been called the receiver is left unblocked between frames and every character that
+ *  arrives outside of a frame is run through the pattern matcher. Frames are still
+ *  delimited by the STARTF and SIGF interrupts exactly as before.
+ *
+ * @note
+ *  This must be called after leuart_open() since the receive TDD test in leuart_open()
+ *  verifies that the receiver blocks characters that are not the start frame. The
+ *  pattern strings must stay valid while the LEUART is open.
+ *
+ * @param[in] *leuart
+ *  Pointer to the LEUART peripheral.
+ *
+ * @param[in] patterns
+ *  Array of zero terminated strings to match, at most LEUART_IDLE_MAX_PATTERNS.
+ *
+ * @param[in] count
+ *  Number of strings in patterns.
+ *
+ * @param[in] idle_evt
+ *  Scheduled event posted when any of the strings has been received.
+ ******************************************************************************/
+void leuart_idle_match_open(LEUART_TypeDef *leuart, const char * const *patterns, uint32_t count, uint32_t idle_evt) {
+  EFM_ASSERT(leuart == LEUART0);
+  EFM_ASSERT(count <= LEUART_IDLE_MAX_PATTERNS);
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  leuart0_read_vals.idle_patterns = patterns;
+  leuart0_read_vals.idle_count = count;
+  for (uint32_t i = 0; i < count; i++) leuart0_read_vals.idle_progress[i] = 0;
+  leuart0_read_vals.idle_evt = idle_evt;
+  leuart0_read_vals.idle_scan = true;
+  leuart->IEN |= LEUART_IEN_RXDATAV;
+  leuart->CMD = LEUART_CMD_RXBLOCKDIS;
+  CORE_EXIT_CRITICAL();
+  while(leuart->SYNCBUSY);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns the index of the idle pattern matched last.
+ ******************************************************************************/
+uint32_t leuart_idle_match_get(void) {
+  return leuart0_read_vals.idle_match;
+}
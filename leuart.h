@@ -29,6 +29,7 @@
 //***********************************************************************************
 
 #define NO_DATA       0
+#define LEUART_IDLE_MAX_PATTERNS  5   // unframed strings that can be matched while no frame is being received
 
 
 
@@ -95,6 +96,13 @@ typedef struct {
 
   DEFINED_STATES_LEUART_READ current_state_read;
 
+  const char * const *idle_patterns; //unframed strings matched between frames, such as module notifications
+  uint32_t idle_count;
+  uint32_t idle_progress[LEUART_IDLE_MAX_PATTERNS]; //characters of each pattern matched so far
+  volatile uint32_t idle_match; //index of the last pattern matched
+  uint32_t idle_evt; //scheduled event posted on a match
+  bool idle_scan;
+
 }LEUART0_STATE_MACHINE_READ;
 
 //***********************************************************************************
@@ -123,6 +131,8 @@ void leuart_startframe(LEUART0_STATE_MACHINE_READ *sm_read); // should be asynch
 void leuart_sigframe(LEUART0_STATE_MACHINE_READ *sm_read); //should be asynchronous so use a differnt state machine
 void leuart_rx_tdd(void); //FOR READING PURPOSES
 void return_read_val (char * ret_read); //doxygen done
+void leuart_idle_match_open(LEUART_TypeDef *leuart, const char * const *patterns, uint32_t count, uint32_t idle_evt);
+uint32_t leuart_idle_match_get(void);
 
 
 
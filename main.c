@@ -59,36 +59,72 @@ int main(void)
 
 
           if(get_scheduled_events() & LETIMER0_UF_CB) {
-              remove_scheduled_event(get_scheduled_events());
+              remove_scheduled_event(LETIMER0_UF_CB);
               scheduled_letimer0_uf_cb(); //scheduler.h defined in main.h
 
           }
 
           if(get_scheduled_events() & LETIMER0_COMP0_CB) {
-              remove_scheduled_event(get_scheduled_events());
+              remove_scheduled_event(LETIMER0_COMP0_CB);
               scheduled_letimer0_comp0_cb();
           }
 
           if(get_scheduled_events() & LETIMER0_COMP1_CB) {
-              remove_scheduled_event(get_scheduled_events());
+              remove_scheduled_event(LETIMER0_COMP1_CB);
               scheduled_letimer0_comp1_cb();
           }
           if(get_scheduled_events() & SI1133_LIGHT_CB) {
-              remove_scheduled_event(get_scheduled_events());
+              remove_scheduled_event(SI1133_LIGHT_CB);
               scheduled_si1133_read_cb();
           }
           if(get_scheduled_events() & BOOT_UP_CB) {
-              remove_scheduled_event(get_scheduled_events());
+              remove_scheduled_event(BOOT_UP_CB);
               scheduled_bootup_cb();
           }
           if(get_scheduled_events() & TX_CB) {
-              remove_scheduled_event(get_scheduled_events());
+              remove_scheduled_event(TX_CB);
               scheduled_tx_cb();
           }
           if(get_scheduled_events() & RX_CB) {
-              remove_scheduled_event(get_scheduled_events());
+              remove_scheduled_event(RX_CB);
               scheduled_rx_cb();
           }
+          if(get_scheduled_events() & ARQ_DONE_CB) {
+              remove_scheduled_event(ARQ_DONE_CB);
+              scheduled_arq_done_cb();
+          }
+          if(get_scheduled_events() & ARQ_RTO_CB) {
+              remove_scheduled_event(ARQ_RTO_CB);
+              scheduled_arq_rto_cb();
+          }
+          if(get_scheduled_events() & BLE_LINK_CB) {
+              remove_scheduled_event(BLE_LINK_CB);
+              scheduled_ble_link_cb();
+          }
+          if(get_scheduled_events() & SI1133_INT_CB) {
+              remove_scheduled_event(SI1133_INT_CB);
+              scheduled_si1133_int_cb();
+          }
+          if(get_scheduled_events() & SI1133_STEP_CB) {
+              remove_scheduled_event(SI1133_STEP_CB);
+              scheduled_si1133_step_cb();
+          }
+          if(get_scheduled_events() & SI1133_SAMPLE_CB) {
+              remove_scheduled_event(SI1133_SAMPLE_CB);
+              scheduled_si1133_sample_cb();
+          }
+          if(get_scheduled_events() & SI1133_READY_CB) {
+              remove_scheduled_event(SI1133_READY_CB);
+              scheduled_si1133_ready_cb();
+          }
+          if(get_scheduled_events() & BURST_DONE_CB) {
+              remove_scheduled_event(BURST_DONE_CB);
+              scheduled_burst_done_cb();
+          }
+          if(get_scheduled_events() & I2C_SERVICE_CB) {
+              remove_scheduled_event(I2C_SERVICE_CB);
+              scheduled_i2c_service_cb();
+          }
 
 }
 }
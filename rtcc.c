@@ -0,0 +1,145 @@
+/**
+ * @file rtcc.c
+ * @author agent
+ * @date 10/18/2026
+ * @brief One shot deadlines on the RTCC compare channels, for timing that has to go on while the CPU sleeps in EM2
+ *
+ */
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "rtcc.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static bool rtcc_opened = false;
+static uint32_t rtcc_evt[RTCC_CHANNELS]; //scheduled event posted when the compare of rtcc_event() matches
+static volatile bool rtcc_armed[RTCC_CHANNELS];
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *  Starts the RTCC counting milliseconds from the ULFRCO, with RTCC_CHANNELS compares.
+ *
+ * @details
+ *  LETIMER0 has no compare left over, COMP0 sets the period and COMP1 the PWM, and TIMER0 belongs
+ *  to timer_event() and stops in EM2. The RTCC keeps counting in EM2 and EM3, so a deadline
+ *  armed on it wakes the CPU on time whatever the LETIMER period. Only the first call does anything.
+ ******************************************************************************/
+void rtcc_open(void) {
+  RTCC_Init_TypeDef rtcc_init = RTCC_INIT_DEFAULT;
+  RTCC_CCChConf_TypeDef compare = RTCC_CH_INIT_COMPARE_DEFAULT;
+
+  if (rtcc_opened) return;
+  CMU_ClockSelectSet(cmuClock_LFE, cmuSelect_ULFRCO);
+  CMU_ClockEnable(cmuClock_RTCC, true);
+  rtcc_init.enable = false;
+  rtcc_init.debugRun = false;
+  rtcc_init.presc = rtccCntPresc_1;
+  RTCC_Init(&rtcc_init);
+  for (uint32_t ch = 0; ch < RTCC_CHANNELS; ch++) RTCC_ChannelInit(ch, &compare);
+  RTCC_IntClear(RTCC_IFC_CC0 | RTCC_IFC_CC1 | RTCC_IFC_CC2);
+  NVIC_EnableIRQ(RTCC_IRQn);
+  RTCC_Enable(true);
+  rtcc_opened = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns the milliseconds counted since rtcc_open().
+ *
+ * @details
+ *  Unlike letimer_time_get() it keeps counting while LETIMER0 is stopped, at the end of a burst
+ *  for instance, so timeouts measured against it never freeze.
+ ******************************************************************************/
+uint32_t rtcc_time_get(void) {
+  EFM_ASSERT(rtcc_opened);
+  return RTCC_CounterGet();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Posts evt once ms_delay has passed, replacing any deadline still pending on the channel.
+ *
+ * @details
+ *  Unlike timer_event() the deadline may be moved at any time, earlier or later, which is what a
+ *  driver tracking the nearest of several timeouts needs. Each channel is owned by one user, see
+ *  RTCC_CH_I2C and the ones after it. A delay shorter than RTCC_MIN_TICKS is stretched to it.
+ *  EM4 is blocked while a deadline is armed.
+ *
+ * @param[in] ch
+ *  Compare channel, below RTCC_CHANNELS
+ *
+ * @param[in] ms_delay
+ *  Delay in milliseconds
+ *
+ * @param[in] evt
+ *  Scheduled event posted when the delay has expired
+ ******************************************************************************/
+void rtcc_event(uint32_t ch, uint32_t ms_delay, uint32_t evt) {
+  uint32_t flag = RTCC_IF_CC0 << ch;
+
+  EFM_ASSERT(rtcc_opened && ch < RTCC_CHANNELS);
+  if (ms_delay < RTCC_MIN_TICKS) ms_delay = RTCC_MIN_TICKS;
+
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  rtcc_evt[ch] = evt;
+  RTCC_IntDisable(flag);
+  RTCC_ChannelCCVSet(ch, RTCC_CounterGet() + ms_delay);
+  RTCC_IntClear(flag);
+  RTCC_IntEnable(flag);
+  if (!rtcc_armed[ch]) sleep_block_mode(RTCC_EM);
+  rtcc_armed[ch] = true;
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Drops the pending deadline of a channel, if any, without posting its event.
+ ******************************************************************************/
+void rtcc_event_cancel(uint32_t ch) {
+  uint32_t flag = RTCC_IF_CC0 << ch;
+
+  EFM_ASSERT(ch < RTCC_CHANNELS);
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  RTCC_IntDisable(flag);
+  RTCC_IntClear(flag);
+  if (rtcc_armed[ch]) sleep_unblock_mode(RTCC_EM);
+  rtcc_armed[ch] = false;
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Ends the rtcc_event() deadlines that matched: releases EM4 and posts their events.
+ ******************************************************************************/
+void RTCC_IRQHandler(void) {
+  uint32_t int_flag = RTCC->IF & RTCC->IEN;
+
+  RTCC->IFC = int_flag;
+  for (uint32_t ch = 0; ch < RTCC_CHANNELS; ch++) {
+      if (int_flag & (RTCC_IF_CC0 << ch)) {
+          RTCC_IntDisable(RTCC_IF_CC0 << ch);
+          if (rtcc_armed[ch]) sleep_unblock_mode(RTCC_EM);
+          rtcc_armed[ch] = false;
+          add_scheduled_event(rtcc_evt[ch]);
+      }
+  }
+}
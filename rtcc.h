@@ -0,0 +1,47 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef RTCC_HG
+#define RTCC_HG
+
+/* System include statements */
+
+
+/* Silicon Labs include statements */
+#include "em_rtcc.h"
+#include "em_cmu.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "scheduler.h"
+#include "sleep_routines.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define RTCC_HZ         1000  // ULFRCO, undivided: one tick per millisecond, like letimer_time_get()
+#define RTCC_MIN_TICKS  2     // a compare closer than this to the counter could be passed before it is written
+#define RTCC_EM         EM4   // the ULFRCO keeps the RTCC counting down to EM3
+#define RTCC_CHANNELS   3     // compare channels, each holds one deadline of its own
+
+#define RTCC_CH_I2C     0     // nearest I2C attempt timeout or retry, see i2c_service()
+#define RTCC_CH_BLE_ARQ 1     // retransmission timeout of the oldest unacknowledged ARQ frame
+#define RTCC_CH_SI1133  2     // Si1133 power up and conversion waits
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void rtcc_open(void);
+uint32_t rtcc_time_get(void);
+void rtcc_event(uint32_t ch, uint32_t ms_delay, uint32_t evt);
+void rtcc_event_cancel(uint32_t ch);
+void RTCC_IRQHandler(void);
+
+#endif
@@ -35,11 +35,14 @@
  ***/
 
 #include "sleep_routines.h"
+#include "letimer.h"
 
 
 //private variables
 
 static int lowest_energy_mode[MAX_ENERGY_MODES];
+static uint32_t em_entries[MAX_ENERGY_MODES]; //number of times each energy mode was entered
+static uint32_t em_ticks[MAX_ENERGY_MODES]; //LETIMER ticks spent in each energy mode
 //***********************************************
 
 
@@ -57,6 +60,7 @@ static int lowest_energy_mode[MAX_ENERGY_MODES];
   ******************************************************************************/
 
 void enter_sleep(void) {
+  uint32_t sleep_start;
   CORE_DECLARE_IRQ_STATE;
   CORE_ENTER_CRITICAL();
   if (lowest_energy_mode[EM0] > 0) {
@@ -68,17 +72,26 @@ void enter_sleep(void) {
   }
 
   else if (lowest_energy_mode[EM2] > 0) {
+      sleep_start = letimer_time_get();
       EMU_EnterEM1();
+      em_ticks[EM1] += letimer_time_get() - sleep_start;
+      em_entries[EM1]++;
       return;
   }
 
   else if (lowest_energy_mode[EM3] > 0) {
+      sleep_start = letimer_time_get();
       EMU_EnterEM2(true);
+      em_ticks[EM2] += letimer_time_get() - sleep_start;
+      em_entries[EM2]++;
       return;
   }
 
   else {
+      sleep_start = letimer_time_get();
       EMU_EnterEM3(true);
+      em_ticks[EM3] += letimer_time_get() - sleep_start;
+      em_entries[EM3]++;
       return;
   }
 
@@ -174,12 +187,38 @@ void sleep_open(void) {
 
   for (int j=0; j < MAX_ENERGY_MODES; j++) {
       lowest_energy_mode[j] = 0;
+      em_entries[j] = 0;
+      em_ticks[j] = 0;
   }
 
 }
 
 
-
-
-
-
+/***************************************************************************//**
+  * @brief
+  * Copies the energy mode residency counters kept by enter_sleep().
+  *
+  * @details
+  * For every energy mode the number of times it was entered and the LETIMER ticks spent in
+  * it are returned. The time is read from letimer_time_get() before entering and after
+  * waking up, so it has the resolution of the LETIMER clock and stops while the LETIMER is
+  * not running. Time spent in EM0 is not counted, it is the total minus the sleep time.
+  *
+  * @note
+  * Either pointer may be NULL when that set of counters is not needed.
+  *
+  *  @param[out] entries
+  * Array of MAX_ENERGY_MODES entry counts.
+  *
+  *  @param[out] ticks
+  * Array of MAX_ENERGY_MODES residency times in LETIMER ticks.
+*****************************************************************************/
+void sleep_stats_get(uint32_t *entries, uint32_t *ticks) {
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  for (int j=0; j < MAX_ENERGY_MODES; j++) {
+      if (entries) entries[j] = em_entries[j];
+      if (ticks) ticks[j] = em_ticks[j];
+  }
+  CORE_EXIT_CRITICAL();
+}
@@ -22,6 +22,7 @@ void sleep_block_mode(uint32_t EM);
 void sleep_unblock_mode(uint32_t EM);
 void enter_sleep(void);
 uint32_t current_block_energy_mode(void);
+void sleep_stats_get(uint32_t *entries, uint32_t *ticks);
 
 
 
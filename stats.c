@@ -0,0 +1,225 @@
+/**
+ * @file stats.c
+ * @author agent
+ * @date 10/18/2026
+ * @brief Windowed minimum, maximum, mean and variance of a sample stream in constant time and memory
+ *
+ */
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "stats.h"
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void stats_reset(STATS_WINDOW *window);
+static void stats_deque_push(STATS_DEQUE *deque, uint32_t seq, uint32_t value, bool keep_min);
+static void stats_deque_expire(STATS_DEQUE *deque, uint32_t oldest_seq);
+static void stats_welford_add(STATS_WINDOW *window, uint32_t sample);
+static void stats_welford_remove(STATS_WINDOW *window, uint32_t sample);
+static void stats_reseed(STATS_WINDOW *window);
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ *  Sets up a statistics window and empties it.
+ *
+ * @details
+ *  A window covers the last length samples and produces a summary every hop samples. With hop equal
+ *  to length the windows tumble: each summary covers samples the previous one did not, and the window
+ *  starts over after it. With a smaller hop the window slides and consecutive summaries overlap.
+ *
+ * @param[in] window
+ *  Window to set up
+ *
+ * @param[in] length
+ *  Samples per window, 1 to STATS_MAX_WINDOW
+ *
+ * @param[in] hop
+ *  Samples between two summaries, 1 to length
+ ******************************************************************************/
+void stats_open(STATS_WINDOW *window, uint32_t length, uint32_t hop) {
+  EFM_ASSERT(length > 0 && length <= STATS_MAX_WINDOW);
+  EFM_ASSERT(hop > 0 && hop <= length);
+  window->length = length;
+  window->hop = hop;
+  window->seq = 0;
+  window->since_summary = 0;
+  stats_reset(window);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Adds a sample to a window.
+ *
+ * @details
+ *  Minimum and maximum come from monotonic deques: a new sample drops every entry it dominates from
+ *  the back, and entries older than the window leave from the front, so both cost O(1) amortized.
+ *  Mean and variance follow Welford's update, and in a sliding window the sample leaving is taken
+ *  out with the inverse update. The fixed point rounding of the inverse update is cleared by
+ *  recomputing the state from the ring once per window length, which keeps the amortized cost O(1).
+ *
+ * @param[in] window
+ *  Window set up with stats_open()
+ *
+ * @param[in] sample
+ *  New sample, up to 16 bits
+ *
+ * @return
+ *  true when a summary is due, read it with stats_summary_get()
+ ******************************************************************************/
+bool stats_update(STATS_WINDOW *window, uint32_t sample) {
+  uint32_t slot = window->seq % window->length;
+
+  EFM_ASSERT(sample <= 0xFFFF);
+  if (window->count == window->length) {
+      stats_welford_remove(window, window->ring[slot]);
+  }
+  else {
+      window->count++;
+  }
+  window->ring[slot] = sample;
+  stats_welford_add(window, sample);
+  stats_deque_push(&window->min, window->seq, sample, true);
+  stats_deque_push(&window->max, window->seq, sample, false);
+  window->seq++;
+  if (window->seq >= window->length) {
+      stats_deque_expire(&window->min, window->seq - window->length);
+      stats_deque_expire(&window->max, window->seq - window->length);
+  }
+  if (window->hop < window->length && ++window->since_reseed >= window->length) {
+      stats_reseed(window);
+  }
+  if (++window->since_summary < window->hop) return false;
+  window->since_summary = 0;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Returns the statistics of the samples in the window; a tumbling window starts over afterwards.
+ *
+ * @param[in] window
+ *  Window set up with stats_open()
+ *
+ * @param[out] summary
+ *  Sample count, minimum, maximum, mean and population variance
+ ******************************************************************************/
+void stats_summary_get(STATS_WINDOW *window, STATS_SUMMARY *summary) {
+  summary->count = window->count;
+  if (window->count == 0) {
+      summary->min = summary->max = summary->mean = summary->variance = 0;
+      return;
+  }
+  summary->min = window->min.value[window->min.head];
+  summary->max = window->max.value[window->max.head];
+  summary->mean = (uint32_t)window->mean;
+  summary->variance = (uint64_t)(window->m2 / window->count);
+  if (window->hop == window->length) stats_reset(window);
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Empties the window and restarts its sample numbering.
+ ******************************************************************************/
+void stats_reset(STATS_WINDOW *window) {
+  window->count = 0;
+  window->since_reseed = 0;
+  window->min.head = window->min.count = 0;
+  window->max.head = window->max.count = 0;
+  window->mean = 0;
+  window->m2 = 0;
+  window->seq = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Appends a sample to a monotonic deque after dropping the entries it makes irrelevant.
+ *
+ * @details
+ *  For the minimum, an older entry not smaller than the new sample can never be the minimum again
+ *  while the new sample is in the window; for the maximum the same holds the other way round.
+ ******************************************************************************/
+void stats_deque_push(STATS_DEQUE *deque, uint32_t seq, uint32_t value, bool keep_min) {
+  while (deque->count > 0) {
+      uint32_t back = (deque->head + deque->count - 1) % STATS_MAX_WINDOW;
+      if (keep_min ? (deque->value[back] < value) : (deque->value[back] > value)) break;
+      deque->count--;
+  }
+  uint32_t tail = (deque->head + deque->count) % STATS_MAX_WINDOW;
+  deque->seq[tail] = seq;
+  deque->value[tail] = value;
+  deque->count++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Drops the entries at the front of a deque that are older than oldest_seq.
+ ******************************************************************************/
+void stats_deque_expire(STATS_DEQUE *deque, uint32_t oldest_seq) {
+  while (deque->count > 0 && deque->seq[deque->head] < oldest_seq) {
+      deque->head = (deque->head + 1) % STATS_MAX_WINDOW;
+      deque->count--;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Welford update for a sample entering the window; window->count already includes it.
+ ******************************************************************************/
+void stats_welford_add(STATS_WINDOW *window, uint32_t sample) {
+  int64_t x = (int64_t)sample << STATS_FRACTION;
+  int64_t delta = x - window->mean;
+
+  window->mean += delta / (int64_t)window->count;
+  window->m2 += (delta * (x - window->mean)) >> STATS_FRACTION;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Inverse Welford update for a sample leaving a full window.
+ ******************************************************************************/
+void stats_welford_remove(STATS_WINDOW *window, uint32_t sample) {
+  int64_t x = (int64_t)sample << STATS_FRACTION;
+  int64_t delta = x - window->mean;
+  int64_t remaining = (int64_t)window->count - 1;
+
+  if (remaining == 0) {
+      window->mean = 0;
+      window->m2 = 0;
+      return;
+  }
+  window->mean -= delta / remaining;
+  window->m2 -= (delta * (x - window->mean)) >> STATS_FRACTION;
+  if (window->m2 < 0) window->m2 = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *  Recomputes mean and variance from the samples in the ring, dropping the accumulated rounding.
+ ******************************************************************************/
+void stats_reseed(STATS_WINDOW *window) {
+  uint32_t count = window->count;
+
+  window->since_reseed = 0;
+  window->mean = 0;
+  window->m2 = 0;
+  for (window->count = 1; window->count <= count; window->count++) {
+      stats_welford_add(window, window->ring[(window->seq - count + window->count - 1) % window->length]);
+  }
+  window->count = count;
+}
@@ -0,0 +1,67 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef STATS_HG
+#define STATS_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+#define STATS_MAX_WINDOW    64    // samples a window can span
+#define STATS_FRACTION      12    // fractional bits of the mean and the variance
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+typedef struct { //one monotonic deque, the front holds the extreme of the window
+  uint32_t seq[STATS_MAX_WINDOW]; //sample number, to expire entries that left the window
+  uint32_t value[STATS_MAX_WINDOW];
+  uint32_t head;
+  uint32_t count;
+} STATS_DEQUE;
+
+typedef struct {
+  uint32_t count; //samples summarized
+  uint32_t min;
+  uint32_t max;
+  uint32_t mean; //STATS_FRACTION fractional bits
+  uint64_t variance; //population variance, STATS_FRACTION fractional bits; a 16 bit signal needs more than 32 bits
+} STATS_SUMMARY;
+
+typedef struct {
+  uint32_t length; //samples per window
+  uint32_t hop; //samples between summaries, length for tumbling windows
+  uint32_t ring[STATS_MAX_WINDOW]; //samples of the window, for removal and reseeding
+  uint32_t seq; //samples received
+  uint32_t count; //samples in the window
+  uint32_t since_summary;
+  uint32_t since_reseed;
+  STATS_DEQUE min;
+  STATS_DEQUE max;
+  int64_t mean; //Welford state, STATS_FRACTION fractional bits
+  int64_t m2;
+} STATS_WINDOW;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void stats_open(STATS_WINDOW *window, uint32_t length, uint32_t hop);
+bool stats_update(STATS_WINDOW *window, uint32_t sample);
+void stats_summary_get(STATS_WINDOW *window, STATS_SUMMARY *summary);
+
+#endif
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""Host side of the sliding window ARQ transfer of ble.c (ble_arq_send / #X!).
+
+Receives the @SSPP..PPCC frames, checks them, hands the payload over in order and
+acknowledges cumulatively with #Kss!, the Go-Back-N receiver the device expects.
+
+    arq_peer.py /dev/ttyUSB0 --window 4      pull the trace log of a device through an HM-10
+    arq_peer.py --emulate --loss 0.1         same against an emulated device on a pty
+
+The emulated device follows ble_arq_service() / ble_arq_rx(): frames of BLE_ARQ_PAYLOAD
+bytes, at most the window in flight, one frame on the LEUART at a time, and a timeout
+of BLE_ARQ_RTO armed on the RTCC when the oldest frame is sent. The device runs its
+service on TX done, on an ACK, at that timeout and once per LETIMER period. Frames are paced at 9600 baud 8N1, ACKs reach the
+device --rtt after the frame that caused them (BLE connection events), and --loss
+corrupts that fraction of the frames and drops that fraction of the ACKs.
+"""
+
+import argparse
+import os
+import random
+import select
+import sys
+import threading
+import time
+import termios
+import tty
+
+ARQ_PAYLOAD = 16        # BLE_ARQ_PAYLOAD
+ARQ_RTO = 0.5           # BLE_ARQ_RTO, s
+LINK_BYTES_PER_SEC = 960  # BLE_LINK_BYTES_PER_SEC
+
+
+def frame_parse(line):
+    """Returns (seq, payload) of a good frame, None otherwise."""
+    if len(line) < 5 or line[0] != '@' or len(line) % 2 == 0:
+        return None
+    try:
+        raw = bytes.fromhex(line[1:])
+    except ValueError:
+        return None
+    seq, payload, check = raw[0], raw[1:-1], raw[-1]
+    if (seq + sum(payload)) & 0xFF != check or len(payload) > ARQ_PAYLOAD:
+        return None
+    return seq, payload
+
+
+class Receiver:
+    """Go-Back-N receiver: in order frames only, every frame answered with the next expected."""
+
+    def __init__(self, write):
+        self.write = write
+        self.expected = 0
+        self.data = bytearray()
+        self.done = False
+        self.frames = 0
+        self.bad = 0
+        self.out_of_order = 0
+
+    def line(self, line):
+        if not line.startswith('@'):
+            return          # telemetry sharing the link
+        self.frames += 1
+        frame = frame_parse(line)
+        if frame is None:
+            self.bad += 1
+            return
+        seq, payload = frame
+        if seq == self.expected & 0xFF and not self.done:
+            self.data += payload
+            self.expected += 1
+            self.done = len(payload) < ARQ_PAYLOAD
+        else:
+            self.out_of_order += 1
+        self.write('#K%02X!' % (self.expected & 0xFF))
+
+
+class EmulatedDevice(threading.Thread):
+    """Device end of the link: the ble.c sender behind an HM-10 at 9600 baud."""
+
+    def __init__(self, fd, data, window, loss, period, rtt):
+        super().__init__(daemon=True)
+        self.fd, self.data, self.window, self.loss, self.period, self.rtt = fd, data, window, loss, period, rtt
+        self.acks = []      # (due, seq) of the ACKs still on their way
+        self.frames = len(data) // ARQ_PAYLOAD + 1
+        self.base = self.next = 0
+        self.timer_start = 0.0
+        self.sent = self.retransmits = 0
+        self.rx = ''
+
+    def frame(self, index):
+        payload = self.data[index * ARQ_PAYLOAD:(index + 1) * ARQ_PAYLOAD]
+        seq = index & 0xFF
+        return '@%02X%s%02X\n' % (seq, payload.hex().upper(), (seq + sum(payload)) & 0xFF)
+
+    def service(self, now):
+        if self.next != self.base and now - self.timer_start >= ARQ_RTO:
+            self.retransmits += self.next - self.base
+            self.next = self.base
+        if self.next < self.frames and self.next - self.base < self.window:
+            index = self.next
+            self.next += 1
+            return index
+        return None
+
+    def ack(self, seq):
+        acked = self.base + ((seq - self.base) & 0xFF)
+        if self.base < acked <= self.next:
+            self.base = acked
+            self.timer_start = time.monotonic()
+
+    def poll_rx(self, timeout):
+        ready, _, _ = select.select([self.fd], [], [], max(timeout, 0))
+        if not ready:
+            return False
+        self.rx += os.read(self.fd, 256).decode(errors='replace')
+        while '!' in self.rx:
+            cmd, self.rx = self.rx.split('!', 1)
+            cmd = cmd[cmd.rfind('#'):]
+            if cmd.startswith('#K') and random.random() >= self.loss:
+                self.acks.append((time.monotonic() + self.rtt, int(cmd[2:4], 16)))
+        return True
+
+    def wait(self, until):
+        """Sleeps until the given time or an ACK comes in, returns True on an ACK."""
+        while True:
+            now = time.monotonic()
+            if self.acks and self.acks[0][0] <= now:
+                self.ack(self.acks.pop(0)[1])
+                return True
+            due = min(until, self.acks[0][0]) if self.acks else until
+            if due <= now:
+                return False
+            self.poll_rx(due - now)
+
+    def run(self):
+        tick = time.monotonic()
+        while self.base < self.frames:
+            now = time.monotonic()
+            index = self.service(now)
+            if index is None:
+                until = tick + self.period
+                if self.next != self.base:
+                    until = min(until, self.timer_start + ARQ_RTO)     # RTCC deadline, ARQ_RTO_CB
+                if not self.wait(until) and until == tick + self.period:
+                    tick = time.monotonic()     # LETIMER underflow, ble_service()
+                continue
+            line = self.frame(index)
+            if index == self.base:
+                self.timer_start = time.monotonic()
+            self.sent += 1
+            busy_until = time.monotonic() + len(line) / LINK_BYTES_PER_SEC
+            if random.random() < self.loss:
+                line = line[:5] + ('0' if line[5] != '0' else '1') + line[6:]   # corrupted on the air
+            os.write(self.fd, line.encode())
+            while self.wait(busy_until):
+                pass                                        # TX done once the frame is out
+
+
+def peer_run(fd, window, emulated):
+    rx = Receiver(lambda s: os.write(fd, s.encode()))
+    pending = ''
+    if not emulated:
+        os.write(fd, ('#X%d!' % window).encode())
+    start = None
+    while not rx.done:
+        ready, _, _ = select.select([fd], [], [], 10)
+        if not ready:
+            sys.exit('no frame for 10 s')
+        pending += os.read(fd, 512).decode(errors='replace')
+        while '\n' in pending:
+            line, pending = pending.split('\n', 1)
+            if start is None and line.startswith('@'):
+                start = time.monotonic() - len(line) / LINK_BYTES_PER_SEC
+            rx.line(line.strip())
+    return rx, time.monotonic() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('port', nargs='?', help='serial port of the HM-10 central side')
+    parser.add_argument('--window', type=int, default=4, help='frames in flight, 1 to 8 (#Xn!)')
+    parser.add_argument('--emulate', action='store_true', help='run against an emulated device on a pty')
+    parser.add_argument('--loss', type=float, default=0.0, help='emulated frame and ACK loss, 0 to 1')
+    parser.add_argument('--bytes', type=int, default=256, help='emulated transfer size, a full trace log by default')
+    parser.add_argument('--period', type=float, default=2.0, help='emulated LETIMER period, s')
+    parser.add_argument('--rtt', type=float, default=0.1, help='emulated frame to ACK delay, s')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    if args.emulate:
+        master, slave = os.openpty()
+        tty.setraw(slave)
+        data = bytes(random.randrange(256) for _ in range(args.bytes))
+        device = EmulatedDevice(master, data, args.window, args.loss, args.period, args.rtt)
+        device.start()
+        rx, elapsed = peer_run(slave, args.window, True)
+        device.join(2)
+        if bytes(rx.data) != data:
+            sys.exit('payload mismatch')
+        print('sent %d frames, %d retransmitted' % (device.sent, device.retransmits))
+    elif args.port:
+        fd = os.open(args.port, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = termios.B9600     # HM10_BAUDRATE
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+        rx, elapsed = peer_run(fd, args.window, False)
+        sys.stdout.buffer.write(bytes(rx.data).hex().encode() + b'\n')
+    else:
+        parser.error('give a port or --emulate')
+
+    print('%d bytes in %.2f s, %.0f B/s payload (%.0f%% of the %d B/s link), '
+          '%d frames seen, %d bad, %d out of order'
+          % (len(rx.data), elapsed, len(rx.data) / elapsed,
+             100.0 * len(rx.data) / elapsed / LINK_BYTES_PER_SEC, LINK_BYTES_PER_SEC,
+             rx.frames, rx.bad, rx.out_of_order))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Period change latency of LETIMER0 (letimer_period_set / #U+nnn!), simulated on the host.
+
+Runs LETIMER0 as an event model, counter reloads from COMP0 at every underflow, and changes
+the period at a random point of the period in progress, once per trial, in two ways:
+
+    buffered    letimer_period_set(): the UF interrupt writes the pending COMP0 after the reload
+    stop        the old compare_set(): disable, SYNCBUSY, write COMP0, enable, SYNCBUSY
+
+    letimer_sim.py                          2000 ms to 1500 ms on the ULFRCO
+    letimer_sim.py --old 2000 --new 500 --lfxo --isr 2
+
+The latency is the time from the request to the start of the first period counted with the new
+value, which is what letimer_period_latency_get() reports on the device (#U! prints it after
+"lat"). A glitch is any period that is neither the old nor the new length. --sync is the
+SYNCBUSY wait in counter ticks, during which the stopped counter does not move.
+"""
+
+import argparse
+import heapq
+import random
+
+ULFRCO_HZ = 1000        # LETIMER_ULFRCO_HZ
+LFXO_HZ = 32768         # LETIMER_LFXO_HZ
+MAX_PERIOD_MS = 60000   # LETIMER_MAX_PERIOD_MS
+COMP0_MAX = 0xFFFF      # _LETIMER_COMP0_MASK
+
+
+def letimer_hz(source_hz):
+    """LETIMER_HZ: the source clock after the smallest prescaler that fits LETIMER_MAX_PERIOD_MS."""
+    for presc in range(16):
+        if (MAX_PERIOD_MS * source_hz // 1000) >> presc <= COMP0_MAX:
+            return source_hz >> presc
+    return source_hz >> 15
+
+
+def run(old, new, request, isr, sync, buffered):
+    """Runs one change requested at tick request, returns (latency, period lengths) in ticks."""
+    comp0 = top = old
+    start = 0
+    pending = None
+    latency = None
+    periods = []
+    events = [(request, 2, 'req'), (top + 1, 0, 'uf')]     # a heap; ties: underflow, interrupt, request
+    while events and latency is None:
+        now, _, kind = heapq.heappop(events)
+        if kind == 'uf':
+            periods.append(now - start)
+            start, top = now, comp0
+            if top == new and now > request:
+                latency = now - request
+            heapq.heappush(events, (now + isr, 1, 'isr'))
+            heapq.heappush(events, (now + top + 1, 0, 'uf'))
+        elif kind == 'isr' and pending is not None:
+            comp0, pending = pending, None
+        elif kind == 'req' and buffered:
+            pending = new
+        elif kind == 'req':
+            comp0 = new
+            events = [(t + 2 * sync if k == 'uf' else t, o, k) for t, o, k in events]
+            heapq.heapify(events)
+    return latency, periods
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--old', type=int, default=2000, help='period before the change, ms (PWM_PER_MS)')
+    parser.add_argument('--new', type=int, default=1500, help='period after the change, ms')
+    parser.add_argument('--lfxo', action='store_true', help='LETIMER_CLOCK_LFXO instead of the ULFRCO')
+    parser.add_argument('--isr', type=int, default=0, help='underflow to interrupt handler delay, ticks')
+    parser.add_argument('--sync', type=int, default=3, help='SYNCBUSY wait of the stop path, ticks')
+    parser.add_argument('--trials', type=int, default=1000)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    hz = letimer_hz(LFXO_HZ if args.lfxo else ULFRCO_HZ)
+    old = (args.old * hz + 500) // 1000    # LETIMER_MS_TO_TICKS
+    new = (args.new * hz + 500) // 1000
+    if not 0 < old <= COMP0_MAX or not 0 < new <= COMP0_MAX or old == new:
+        parser.error('periods must differ and fit COMP0')
+    ms = 1000.0 / hz
+
+    print('LETIMER_HZ %d, %d -> %d ticks, %d trials' % (hz, old, new, args.trials))
+    requests = [random.randrange(old + 1) for _ in range(args.trials)]
+    for name, buffered in (('buffered', True), ('stop', False)):
+        latencies, glitches, worst = [], 0, 0
+        for request in requests:
+            latency, periods = run(old, new, request, args.isr, args.sync, buffered)
+            latencies.append(latency)
+            for length in periods:
+                if length not in (old + 1, new + 1):
+                    glitches += 1
+                    worst = max(worst, abs(length - old - 1))
+        print('%-9s latency min %.1f avg %.1f max %.1f ms, %d glitched periods, worst %.1f ms off'
+              % (name, min(latencies) * ms, sum(latencies) / len(latencies) * ms, max(latencies) * ms,
+                 glitches, worst * ms))
+
+
+if __name__ == '__main__':
+    main()